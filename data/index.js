@@ -151,6 +151,85 @@ async function send() {
     post("/update", 0);
 }
 
+/**
+ * Live view of the displays
+ * Loads the framebuffer of every display once and applies the changes pushed by the firmware
+ */
+const live = {};
+
+/**
+ * Load the entire framebuffer of a display
+ * @param {string} name Display name (front, rear or side)
+ */
+async function loadLive(name) {
+    const response = await fetch(`/framebuffer?display=${name}`);
+    const data = new Uint8Array(await response.arrayBuffer());
+    const width = data[0];
+    const height = data[1];
+    const bytesW = Math.ceil(width / 8);
+
+    // Create dots on first load
+    let view = live[name];
+    if (!view) {
+        const element = document.querySelector(`div.live[display="${name}"]`);
+        view = { width, height, boot: "", version: 0, dots: [] };
+        for (let i = 0; i < width * height; i++) {
+            if ((i != 0) & (i % width) == 0) {
+                element.appendChild(document.createElement("br"));
+            }
+            const dot = document.createElement("span");
+            element.appendChild(dot);
+            view.dots.push(dot);
+        }
+        live[name] = view;
+    }
+
+    for (let y = 0; y < height; y++) {
+        for (let x = 0; x < width; x++) {
+            const value = (data[2 + y * bytesW + Math.floor(x / 8)] >> (7 - (x % 8))) & 1;
+            view.dots[y * width + x].setAttribute("on", value ? "1" : "0");
+        }
+    }
+
+    // ETag is "name-boot-version"
+    const etag = (response.headers.get("ETag") || "").replace(/"/g, "").split("-");
+    view.boot = etag[1] || "";
+    view.version = Number(etag[2]) || 0;
+}
+
+/**
+ * Apply the changed bands of a frame event
+ * Bands hold one byte per column, bit 0 is the top row of the band
+ * @param {*} frame Parsed event data
+ */
+function applyLive(frame) {
+    const view = live[frame.display];
+
+    // Missed an update or the firmware restarted, start over
+    if (!view || frame.boot != view.boot || frame.version != view.version + 1) {
+        loadLive(frame.display);
+        return;
+    }
+
+    Object.keys(frame.bands).forEach(band => {
+        const hex = frame.bands[band];
+        for (let x = 0; x < view.width; x++) {
+            const value = parseInt(hex.substr(x * 2, 2), 16);
+            for (let k = 0; k < 5; k++) {
+                const y = Number(band) * 5 + k;
+                if (y < view.height) {
+                    view.dots[y * view.width + x].setAttribute("on", (value >> k) & 1 ? "1" : "0");
+                }
+            }
+        }
+    });
+    view.version = frame.version;
+}
+
+const events = new EventSource("/events");
+events.addEventListener("frame", (e) => applyLive(JSON.parse(e.data)));
+document.querySelectorAll("div.live").forEach((view) => loadLive(view.getAttribute("display")));
+
 /**
  * Add listener for tab switcher
  */
@@ -0,0 +1,182 @@
+/**
+ * @file command.cpp
+ * Transport independent handling of the commands of the web app
+ *
+ * Arne van Iterson, 2023
+ */
+
+#include "./command.hpp"
+#include "mobidot/trace.hpp"
+
+const CommandCore::Command CommandCore::COMMANDS[] = {
+    {"base64", &CommandCore::base64},
+    {"update", &CommandCore::update},
+    {"toggleLight", &CommandCore::toggleLight},
+    {"status", &CommandCore::status},
+};
+
+/**
+ * @returns Value of a base64 character, -1 if it is not one
+ */
+static int base64Value(char c)
+{
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A';
+    if (c >= 'a' && c <= 'z')
+        return c - 'a' + 26;
+    if (c >= '0' && c <= '9')
+        return c - '0' + 52;
+    if (c == '+' || c == ' ') // The web app does not escape '+', form decoding turns it into a space
+        return 62;
+    if (c == '/')
+        return 63;
+    return -1;
+}
+
+/**
+ * @returns Value of a hexadecimal digit, -1 if it is not one
+ */
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+CommandCore::CommandCore(MobiDOT &mobidot, MobiDOTFrameCache *cache)
+{
+    this->MOBIDOT = &mobidot;
+    this->CACHE = cache;
+}
+
+int CommandCore::execute(const char name[], const CommandArgs &args, char response[], size_t size)
+{
+    strncpy(response, "{}", size);
+
+    for (const Command &command : COMMANDS)
+    {
+        if (strcmp(command.name, name) == 0)
+        {
+            return (this->*command.handler)(args, response, size);
+        }
+    }
+    return 404;
+}
+
+uint CommandCore::getCount()
+{
+    return sizeof(COMMANDS) / sizeof(Command);
+}
+
+const char *CommandCore::getName(uint index)
+{
+    return (index < getCount()) ? COMMANDS[index].name : nullptr;
+}
+
+int CommandCore::base64(const CommandArgs &args, char[], size_t)
+{
+    const char *data = args.get("data");
+    if (data == nullptr)
+    {
+        return 400;
+    }
+
+    MOBIDOT_TRACE_SCOPE("base64 decode");
+
+    // Decode straight into the bitmap: base64 to hex digits to bytes, missing bytes stay empty
+    memset(this->BITMAP, 0, sizeof(this->BITMAP));
+
+    uint32_t bits = 0;
+    uint count = 0;
+    size_t digits = 0;
+    for (const char *c = data; *c != '\0' && *c != '='; c++)
+    {
+        const int value = base64Value(*c);
+        if (value < 0)
+        {
+            return 400;
+        }
+
+        bits = (bits << 6 | value) & 0xffff;
+        count += 6;
+        if (count < 8)
+        {
+            continue;
+        }
+        count -= 8;
+
+        const int nibble = hexValue(bits >> count & 0xff);
+        if (nibble < 0)
+        {
+            return 400;
+        }
+
+        // Anything past the size of the bitmap is ignored
+        if (digits / 2 < sizeof(this->BITMAP))
+        {
+            this->BITMAP[digits / 2] |= (digits % 2 == 0) ? nibble << 4 : nibble;
+        }
+        digits++;
+    }
+
+    return 200;
+}
+
+int CommandCore::update(const CommandArgs &args, char[], size_t)
+{
+    const char *priority = args.get("priority");
+    const bool urgent = priority != nullptr && strcmp(priority, "urgent") == 0;
+
+    const MobiDOT::Priority value = (urgent) ? MobiDOT::Priority::URGENT : MobiDOT::Priority::NORMAL;
+    bool queued;
+
+    if (this->CACHE != nullptr)
+    {
+        queued = this->CACHE->drawBitmap(MobiDOT::Display::REAR, this->BITMAP, MOBIDOT_WIDTH_REAR, MOBIDOT_HEIGHT_REAR,
+                                         true, value);
+    }
+    else
+    {
+        this->MOBIDOT->selectDisplay(MobiDOT::Display::REAR);
+        this->MOBIDOT->drawBitmap(this->BITMAP, MOBIDOT_WIDTH_REAR, MOBIDOT_HEIGHT_REAR, true);
+        queued = this->MOBIDOT->update(value);
+    }
+
+    memset(this->BITMAP, 0, sizeof(this->BITMAP));
+    return (queued) ? 200 : 500;
+}
+
+int CommandCore::toggleLight(const CommandArgs &, char[], size_t)
+{
+    this->MOBIDOT->toggleLight();
+    return 200;
+}
+
+int CommandCore::status(const CommandArgs &, char response[], size_t size)
+{
+    MobiDOT *mobidot = this->MOBIDOT;
+    snprintf(response, size,
+             "{\"throughput\":%u,\"sent\":%u,\"coalesced\":%u,\"dropped\":%u,\"busy\":%s,"
+             "\"latency\":{\"background\":[%u,%u],\"normal\":[%u,%u],\"urgent\":[%u,%u]}",
+             mobidot->getThroughput(), mobidot->getSentFrames(), mobidot->getCoalescedFrames(),
+             mobidot->getDroppedFrames(), (mobidot->isBusy()) ? "true" : "false",
+             mobidot->getLatency(MobiDOT::Priority::BACKGROUND), mobidot->getLatency(MobiDOT::Priority::BACKGROUND, true),
+             mobidot->getLatency(MobiDOT::Priority::NORMAL), mobidot->getLatency(MobiDOT::Priority::NORMAL, true),
+             mobidot->getLatency(MobiDOT::Priority::URGENT), mobidot->getLatency(MobiDOT::Priority::URGENT, true));
+
+    const size_t length = strlen(response);
+    if (this->CACHE != nullptr)
+    {
+        snprintf(response + length, size - length, ",\"cache\":{\"hits\":%u,\"spillHits\":%u,\"misses\":%u}}",
+                 this->CACHE->getHits(), this->CACHE->getSpillHits(), this->CACHE->getMisses());
+    }
+    else
+    {
+        snprintf(response + length, size - length, "}");
+    }
+    return 200;
+}
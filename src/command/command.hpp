@@ -0,0 +1,116 @@
+/**
+ * @file command.hpp
+ * Transport independent handling of the commands of the web app
+ *
+ * Commands are looked up by name and read their parameters through CommandArgs, they do not know which transport
+ * the request came in on. main.cpp maps them on AsyncWebServer, tools/loadtest runs the same code behind a host
+ * HTTP server so throughput and latency can be measured without a sign.
+ *
+ * Arne van Iterson, 2023
+ */
+
+#ifndef _COMMAND_HPP_
+#define _COMMAND_HPP_
+
+#include <Arduino.h>
+#include "mobidot/mobidot.hpp"
+#include "mobidot/framecache.hpp"
+
+/* Size of the response buffer passed to CommandCore::execute() */
+#define COMMAND_RESPONSE_SIZE 256
+
+/* Size of the bitmap that is uploaded for the rear display */
+#define COMMAND_BITMAP_SIZE (MOBIDOT_HEIGHT_REAR * ((MOBIDOT_WIDTH_REAR + 7) / 8))
+
+/**
+ * @class CommandArgs class
+ * Parameters of a command, implemented by every transport
+ */
+class CommandArgs
+{
+public:
+    /**
+     * get function
+     * @param name Name of the parameter
+     * @returns Value of the parameter, nullptr if it is missing
+     */
+    virtual const char *get(const char *name) const = 0;
+};
+
+/**
+ * @class CommandCore class
+ */
+class CommandCore
+{
+public:
+    /**
+     * CommandCore class constructor
+     * @param mobidot Display controller the commands draw on
+     * @param cache Cache the frames of update are sent through (optional, frames are encoded every time if not specified)
+     */
+    CommandCore(MobiDOT &mobidot, MobiDOTFrameCache *cache = nullptr);
+
+    /**
+     * execute function
+     * Runs a command
+     * @param name Name of the command, see getName()
+     * @param args Parameters of the command
+     * @param response Buffer for the JSON response, at least COMMAND_RESPONSE_SIZE bytes
+     * @param size Size of the response buffer
+     * @returns HTTP status code, 404 if the command does not exist
+     */
+    int execute(const char name[], const CommandArgs &args, char response[], size_t size);
+
+    /**
+     * getCount and getName functions
+     * Lists the commands, so transports can register them
+     * @param index Index of the command, up to getCount()
+     * @returns Amount of commands or the name of a command
+     */
+    static uint getCount();
+    static const char *getName(uint index);
+
+private:
+    MobiDOT *MOBIDOT;
+    MobiDOTFrameCache *CACHE;
+
+    // Bitmap for the rear display, filled by base64 and sent by update
+    unsigned char BITMAP[COMMAND_BITMAP_SIZE] = {0};
+
+    /**
+     * @struct Command
+     * Name and handler of a command
+     */
+    struct Command
+    {
+        const char *name;
+        int (CommandCore::*handler)(const CommandArgs &args, char response[], size_t size);
+    };
+    static const Command COMMANDS[];
+
+    /**
+     * base64 command
+     * Stores a bitmap for the rear display, data holds the bitmap bytes as a hexadecimal string encoded in base64
+     */
+    int base64(const CommandArgs &args, char response[], size_t size);
+
+    /**
+     * update command
+     * Draws the stored bitmap on the rear display and clears it, priority=urgent interrupts the frame being sent
+     */
+    int update(const CommandArgs &args, char response[], size_t size);
+
+    /**
+     * toggleLight command
+     * Toggles the frontlight
+     */
+    int toggleLight(const CommandArgs &args, char response[], size_t size);
+
+    /**
+     * status command
+     * Transmitter statistics, latency in milliseconds per priority and the frame cache counters if there is a cache
+     */
+    int status(const CommandArgs &args, char response[], size_t size);
+};
+
+#endif // _COMMAND_HPP_
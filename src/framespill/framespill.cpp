@@ -0,0 +1,80 @@
+/**
+ * @file framespill.cpp
+ * Keeps frames evicted from the RAM frame cache on LittleFS
+ *
+ * Arne van Iterson, 2023
+ */
+
+#include "./framespill.hpp"
+
+char *FrameSpill::load(uint64_t key, uint &size)
+{
+    char target[24];
+    this->path(key, false, target);
+
+    if (!LittleFS.exists(target))
+    {
+        return nullptr;
+    }
+
+    File file = LittleFS.open(target, "r");
+    if (!file)
+    {
+        return nullptr;
+    }
+
+    // Another frame may have replaced it
+    uint64_t stored = 0;
+    const size_t length = file.size();
+    if (length <= sizeof(stored) || length - sizeof(stored) > RS485_BUFFER_SIZE ||
+        file.read((uint8_t *)&stored, sizeof(stored)) != sizeof(stored) || stored != key)
+    {
+        file.close();
+        return nullptr;
+    }
+
+    size = length - sizeof(stored);
+    char *buffer = new char[size];
+    const size_t read = file.read((uint8_t *)buffer, size);
+    file.close();
+
+    if (read != size)
+    {
+        delete[] buffer;
+        return nullptr;
+    }
+    return buffer;
+}
+
+void FrameSpill::store(uint64_t key, const char data[], uint size)
+{
+    char target[24];
+    char temporary[24];
+    this->path(key, false, target);
+    this->path(key, true, temporary);
+
+    if (!LittleFS.exists(FRAMESPILL_DIRECTORY))
+    {
+        LittleFS.mkdir(FRAMESPILL_DIRECTORY);
+    }
+
+    File file = LittleFS.open(temporary, "w");
+    if (!file)
+    {
+        return;
+    }
+
+    size_t written = file.write((const uint8_t *)&key, sizeof(key));
+    written += file.write((const uint8_t *)data, size);
+    file.close();
+
+    if (written != sizeof(key) + size || !LittleFS.rename(temporary, target))
+    {
+        LittleFS.remove(temporary);
+    }
+}
+
+void FrameSpill::path(uint64_t key, bool temporary, char output[])
+{
+    snprintf(output, 24, FRAMESPILL_DIRECTORY "/%u.%s", (uint)(key % FRAMESPILL_FILES), (temporary) ? "tmp" : "bin");
+}
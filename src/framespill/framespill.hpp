@@ -0,0 +1,63 @@
+/**
+ * @file framespill.hpp
+ * Keeps frames evicted from the RAM frame cache on LittleFS
+ *
+ * Files are picked by the hash of the frame, so the amount of flash used stays bounded: a frame replaces whatever frame
+ * used the same file before. Every file starts with the hash of its frame, so a replaced frame is never mistaken for
+ * the one that was looked up.
+ *
+ * Arne van Iterson, 2023
+ */
+
+#ifndef _FRAMESPILL_HPP_
+#define _FRAMESPILL_HPP_
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#include "mobidot/mobidot.hpp"
+#include "mobidot/framecache.hpp"
+
+/* Directory the frames are stored in */
+#define FRAMESPILL_DIRECTORY "/cache"
+
+/* Amount of files in the directory */
+#define FRAMESPILL_FILES 32
+
+/**
+ * @class FrameSpill class
+ */
+class FrameSpill : public MobiDOTFrameSpill
+{
+public:
+    /**
+     * load function
+     * Reads a frame, LittleFS has to be mounted before calling this
+     * @param key Hash of the frame content
+     * @param size Set to the size of the frame
+     * @returns New buffer holding the frame, nullptr if the frame is not stored
+     */
+    char *load(uint64_t key, uint &size) override;
+
+    /**
+     * store function
+     * Writes a frame, it is written to a temporary file first and renamed afterwards so a power cut
+     * never leaves a half written frame behind
+     * @param key Hash of the frame content
+     * @param data Frame data
+     * @param size Size of the frame data
+     */
+    void store(uint64_t key, const char data[], uint size) override;
+
+private:
+    /**
+     * path function
+     * Writes the path of the file of a frame to the output array
+     * @param key Hash of the frame content
+     * @param temporary Path of the temporary file instead
+     * @param output Output array, at least 24 bytes
+     */
+    void path(uint64_t key, bool temporary, char output[]);
+};
+
+#endif // _FRAMESPILL_HPP_
@@ -0,0 +1,147 @@
+/**
+ * @file framestore.cpp
+ * Keeps the last frame sent to each display on LittleFS
+ *
+ * Arne van Iterson, 2023
+ */
+
+#include "./framestore.hpp"
+
+void FrameStore::loop(MobiDOT &mobidot)
+{
+    for (uint i = 0; i < MOBIDOT_DISPLAY_COUNT; i++)
+    {
+        const MobiDOT::Display type = (MobiDOT::Display)i;
+
+        const uint32_t version = mobidot.getFrameVersion(type);
+        if (version != this->VERSION[i])
+        {
+            this->VERSION[i] = version;
+            this->CHANGED[i] = millis();
+            this->PENDING[i] = true;
+        }
+
+        // Wait until the display settles and its frames are sent, the framebuffer is final then
+        if (!this->PENDING[i] || millis() - this->CHANGED[i] < FRAMESTORE_DELAY || mobidot.isBusy(type))
+        {
+            continue;
+        }
+
+        char *data;
+        const uint size = mobidot.encodeFramebuffer(type, data);
+        if (this->save(type, data, size))
+        {
+            this->PENDING[i] = false;
+        }
+        else
+        {
+            // Try again later, e.g. when the flash was full
+            this->CHANGED[i] = millis();
+        }
+        delete[] data;
+    }
+}
+
+bool FrameStore::save(MobiDOT::Display type, const char data[], uint size)
+{
+    // Skip the write if this frame is stored already
+    const uint32_t value = this->hash(data, size);
+    if (value == this->HASH[(uint)type])
+    {
+        return true;
+    }
+
+    char target[24];
+    char temporary[24];
+    this->path(type, false, target);
+    this->path(type, true, temporary);
+
+    if (!LittleFS.exists(FRAMESTORE_DIRECTORY))
+    {
+        LittleFS.mkdir(FRAMESTORE_DIRECTORY);
+    }
+
+    File file = LittleFS.open(temporary, "w");
+    if (!file)
+    {
+        return false;
+    }
+
+    const size_t written = file.write((const uint8_t *)data, size);
+    file.close();
+
+    if (written != size || !LittleFS.rename(temporary, target))
+    {
+        LittleFS.remove(temporary);
+        return false;
+    }
+
+    this->HASH[(uint)type] = value;
+    return true;
+}
+
+uint FrameStore::replay(MobiDOT &mobidot)
+{
+    uint count = 0;
+
+    for (uint i = 0; i < MOBIDOT_DISPLAY_COUNT; i++)
+    {
+        char target[24];
+        this->path((MobiDOT::Display)i, false, target);
+
+        if (!LittleFS.exists(target))
+        {
+            continue;
+        }
+
+        File file = LittleFS.open(target, "r");
+        if (!file)
+        {
+            continue;
+        }
+
+        // Frames larger than the display buffer can not have been sent by this firmware
+        const size_t size = file.size();
+        if (size == 0 || size > RS485_BUFFER_SIZE)
+        {
+            file.close();
+            continue;
+        }
+
+        char *buffer = new char[size];
+        const size_t read = file.read((uint8_t *)buffer, size);
+        file.close();
+
+        if (read == size)
+        {
+            // Remember what is stored, sending it again will call the frame callback with the same data
+            this->HASH[i] = this->hash(buffer, size);
+
+            if (mobidot.send(buffer, size))
+            {
+                count++;
+            }
+        }
+
+        delete[] buffer;
+    }
+
+    return count;
+}
+
+uint32_t FrameStore::hash(const char data[], uint size)
+{
+    uint32_t value = 2166136261u;
+    for (size_t i = 0; i < size; i++)
+    {
+        value = (value ^ (uint8_t)data[i]) * 16777619u;
+    }
+
+    // 0 is reserved for 'nothing stored'
+    return (value) ? value : 1;
+}
+
+void FrameStore::path(MobiDOT::Display type, bool temporary, char output[])
+{
+    snprintf(output, 24, FRAMESTORE_DIRECTORY "/%u.%s", (uint)type, (temporary) ? "tmp" : "bin");
+}
@@ -0,0 +1,90 @@
+/**
+ * @file framestore.hpp
+ * Keeps the last frame sent to each display on LittleFS
+ *
+ * What a display shows according to MobiDOT::getFramebuffer() is stored as one frame covering the entire display, in
+ * wire format so it can be sent again using MobiDOT::send() right after booting, long before WiFi is connected. Only
+ * the result of partial frames (text at an offset, deltas, marquee steps) is stored, never a fragment of it. Text in
+ * fonts built into the display is not part of the framebuffer and is not stored.
+ *
+ * A display is only stored once it has not changed for FRAMESTORE_DELAY, so animations do not wear out the flash, and
+ * the write happens from loop() instead of the frame callback, which runs in the middle of MobiDOT::loop().
+ *
+ * Arne van Iterson, 2023
+ */
+
+#ifndef _FRAMESTORE_HPP_
+#define _FRAMESTORE_HPP_
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#include "mobidot/mobidot.hpp"
+
+/* Directory the frames are stored in, one file per display */
+#define FRAMESTORE_DIRECTORY "/frames"
+
+/* Time a display has to stay the same before it is stored, in milliseconds */
+#define FRAMESTORE_DELAY 5000
+
+/**
+ * @class FrameStore class
+ */
+class FrameStore
+{
+public:
+    /**
+     * loop function
+     * Stores the displays that did not change for FRAMESTORE_DELAY, call this from loop()
+     * @param mobidot Display controller the frames are sent with
+     */
+    void loop(MobiDOT &mobidot);
+
+    /**
+     * replay function
+     * Sends the stored frame of every display, LittleFS has to be mounted before calling this
+     * @param mobidot Display controller to send the frames with
+     * @returns Amount of frames sent
+     */
+    uint replay(MobiDOT &mobidot);
+
+private:
+    // Hash of the frame stored for each display, 0 if unknown
+    uint32_t HASH[MOBIDOT_DISPLAY_COUNT] = {0};
+
+    // Frame version of each display seen last, when it changed and whether it still has to be stored
+    uint32_t VERSION[MOBIDOT_DISPLAY_COUNT] = {0};
+    unsigned long CHANGED[MOBIDOT_DISPLAY_COUNT] = {0};
+    bool PENDING[MOBIDOT_DISPLAY_COUNT] = {false};
+
+    /**
+     * save function
+     * Stores a frame, it is written to a temporary file first and renamed afterwards so a power cut
+     * never leaves a half written frame behind. Frames equal to the stored frame are not written again to save flash.
+     * @param type Display the frame belongs to
+     * @param data Frame data
+     * @param size Size of the frame data
+     * @returns True if the frame is stored
+     */
+    bool save(MobiDOT::Display type, const char data[], uint size);
+
+    /**
+     * hash function
+     * FNV-1a hash of a frame, used to skip writing frames that are already stored
+     * @param data Frame data
+     * @param size Size of the frame data
+     * @returns Hash of the frame
+     */
+    uint32_t hash(const char data[], uint size);
+
+    /**
+     * path function
+     * Writes the path of the file of a display to the output array
+     * @param type Display type
+     * @param temporary Path of the temporary file instead
+     * @param output Output array, at least 24 bytes
+     */
+    void path(MobiDOT::Display type, bool temporary, char output[]);
+};
+
+#endif // _FRAMESTORE_HPP_
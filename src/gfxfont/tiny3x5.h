@@ -0,0 +1,49 @@
+// 3x5 pixel font for clocks and counters, ASCII 0x20 up to ':' (digits and punctuation).
+// Glyphs are 3 columns wide with 1 column of spacing and sit on the baseline, so a line of text is exactly one band
+// of the display high. The arrays are constexpr so the font can also be converted with MOBIDOT_BAND_FONT.
+
+#ifndef _TINY3X5_H_
+#define _TINY3X5_H_
+
+#include "./gfxfont.h"
+
+constexpr uint8_t Tiny3x5Bitmaps[] PROGMEM = {
+    0xe8, 0xb4, 0xbe, 0xfa, 0x79, 0x3c, 0x85, 0x42, 0x55, 0x56, 0xc0, 0x6a,
+    0x40, 0x95, 0x80, 0xaa, 0x80, 0x5d, 0x00, 0x60, 0xe0, 0x80, 0x25, 0x48,
+    0xf6, 0xde, 0x59, 0x2e, 0xe7, 0xce, 0xe5, 0x9e, 0xb7, 0x92, 0xf3, 0x9e,
+    0xf3, 0xde, 0xe5, 0x24, 0xf7, 0xde, 0xf7, 0x9e, 0xa0,
+};
+
+constexpr GFXglyph Tiny3x5Glyphs[] PROGMEM = {
+    {0, 0, 0, 4, 0, 0}, // 0x20 ' '
+    {0, 1, 5, 4, 1, -5}, // 0x21 '!'
+    {1, 3, 2, 4, 0, -5}, // 0x22 '"'
+    {2, 3, 5, 4, 0, -5}, // 0x23 '#'
+    {4, 3, 5, 4, 0, -5}, // 0x24 '$'
+    {6, 3, 5, 4, 0, -5}, // 0x25 '%'
+    {8, 3, 5, 4, 0, -5}, // 0x26 '&'
+    {10, 1, 2, 4, 1, -5}, // 0x27 '''
+    {11, 2, 5, 4, 1, -5}, // 0x28 '('
+    {13, 2, 5, 4, 0, -5}, // 0x29 ')'
+    {15, 3, 3, 4, 0, -4}, // 0x2a '*'
+    {17, 3, 3, 4, 0, -4}, // 0x2b '+'
+    {19, 2, 2, 4, 0, -2}, // 0x2c ','
+    {20, 3, 1, 4, 0, -3}, // 0x2d '-'
+    {21, 1, 1, 4, 1, -1}, // 0x2e '.'
+    {22, 3, 5, 4, 0, -5}, // 0x2f '/'
+    {24, 3, 5, 4, 0, -5}, // 0x30 '0'
+    {26, 3, 5, 4, 0, -5}, // 0x31 '1'
+    {28, 3, 5, 4, 0, -5}, // 0x32 '2'
+    {30, 3, 5, 4, 0, -5}, // 0x33 '3'
+    {32, 3, 5, 4, 0, -5}, // 0x34 '4'
+    {34, 3, 5, 4, 0, -5}, // 0x35 '5'
+    {36, 3, 5, 4, 0, -5}, // 0x36 '6'
+    {38, 3, 5, 4, 0, -5}, // 0x37 '7'
+    {40, 3, 5, 4, 0, -5}, // 0x38 '8'
+    {42, 3, 5, 4, 0, -5}, // 0x39 '9'
+    {44, 1, 3, 4, 1, -4}, // 0x3a ':'
+};
+
+const GFXfont Tiny3x5 PROGMEM = {(uint8_t *)Tiny3x5Bitmaps, (GFXglyph *)Tiny3x5Glyphs, 0x20, 0x3a, 6};
+
+#endif // _TINY3X5_H_
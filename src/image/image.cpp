@@ -0,0 +1,289 @@
+/**
+ * @file image.cpp
+ * Converts a streamed grayscale image to the geometry of a display
+ *
+ * Arne van Iterson, 2023
+ */
+
+#include "./image.hpp"
+
+/* Largest source image accepted */
+#define IMAGE_MAX_SIZE 4096
+
+/* 4x4 Bayer matrix for ordered dithering */
+static const uint8_t bayer[4][4] PROGMEM = {
+    {0, 8, 2, 10},
+    {12, 4, 14, 6},
+    {3, 11, 1, 9},
+    {15, 7, 13, 5}};
+
+ImageIngest::ImageIngest(MobiDOTBands &target, ImageIngest::Dither dither, bool invert)
+{
+    this->TARGET = &target;
+    this->DITHER = dither;
+    this->INVERT = invert;
+}
+
+ImageIngest::~ImageIngest()
+{
+    delete[] this->SUMS;
+    delete[] this->COUNTS;
+    delete[] this->ERROR_CURRENT;
+    delete[] this->ERROR_NEXT;
+    delete[] this->ROW;
+}
+
+bool ImageIngest::write(const uint8_t data[], size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        switch (this->STATE)
+        {
+        case ImageIngest::State::PIXELS:
+            this->pixel(data[i]);
+            break;
+        case ImageIngest::State::DONE:
+            // Trailing data is ignored
+            return true;
+        case ImageIngest::State::FAILED:
+            return false;
+        default:
+            this->header(data[i]);
+            break;
+        }
+    }
+
+    return this->STATE != ImageIngest::State::FAILED;
+}
+
+bool ImageIngest::isFinished()
+{
+    return this->STATE == ImageIngest::State::DONE;
+}
+
+void ImageIngest::header(uint8_t value)
+{
+    // Magic number, only binary graymaps are supported
+    if (this->STATE == ImageIngest::State::MAGIC)
+    {
+        if (this->FIELD == 0 && value == 'P')
+        {
+            this->FIELD = 1;
+        }
+        else if (this->FIELD == 1 && value == '5')
+        {
+            this->FIELD = 0;
+            this->STATE = ImageIngest::State::WIDTH;
+        }
+        else
+        {
+            this->STATE = ImageIngest::State::FAILED;
+        }
+        return;
+    }
+
+    // Comments run until the end of the line
+    if (this->COMMENT)
+    {
+        this->COMMENT = (value != '\n' && value != '\r');
+        return;
+    }
+
+    if (value == '#' && !this->FIELD_DIGITS)
+    {
+        this->COMMENT = true;
+        return;
+    }
+
+    if (value >= '0' && value <= '9')
+    {
+        this->FIELD = this->FIELD * 10 + (value - '0');
+        this->FIELD_DIGITS = true;
+
+        if (this->FIELD > IMAGE_MAX_SIZE)
+        {
+            this->STATE = ImageIngest::State::FAILED;
+        }
+        return;
+    }
+
+    if (value != ' ' && value != '\t' && value != '\n' && value != '\r')
+    {
+        this->STATE = ImageIngest::State::FAILED;
+        return;
+    }
+
+    // Whitespace between fields
+    if (!this->FIELD_DIGITS)
+    {
+        return;
+    }
+
+    const uint32_t field = this->FIELD;
+    this->FIELD = 0;
+    this->FIELD_DIGITS = false;
+
+    switch (this->STATE)
+    {
+    case ImageIngest::State::WIDTH:
+        this->SRC_WIDTH = field;
+        this->STATE = (field) ? ImageIngest::State::HEIGHT : ImageIngest::State::FAILED;
+        break;
+    case ImageIngest::State::HEIGHT:
+        this->SRC_HEIGHT = field;
+        this->STATE = (field) ? ImageIngest::State::MAXVAL : ImageIngest::State::FAILED;
+        break;
+    case ImageIngest::State::MAXVAL:
+        // A single whitespace character separates maxval from the pixel data, only 1 byte per pixel is supported
+        if (field == 0 || field > 255)
+        {
+            this->STATE = ImageIngest::State::FAILED;
+            break;
+        }
+        this->SCALE = (255 << 16) / field;
+        this->STATE = ImageIngest::State::PIXELS;
+        this->begin();
+        break;
+    default:
+        break;
+    }
+}
+
+void ImageIngest::begin()
+{
+    const uint32_t width = this->SRC_WIDTH;
+    const uint32_t height = this->SRC_HEIGHT;
+    const uint32_t targetWidth = this->TARGET->getWidth();
+    const uint32_t targetHeight = this->TARGET->getHeight();
+
+    // Fit the image in the target keeping the aspect ratio, small images are not enlarged
+    if (width <= targetWidth && height <= targetHeight)
+    {
+        this->DST_WIDTH = width;
+        this->DST_HEIGHT = height;
+    }
+    else if (width * targetHeight > height * targetWidth)
+    {
+        this->DST_WIDTH = targetWidth;
+        this->DST_HEIGHT = max(height * targetWidth / width, (uint32_t)1);
+    }
+    else
+    {
+        this->DST_WIDTH = max(width * targetHeight / height, (uint32_t)1);
+        this->DST_HEIGHT = targetHeight;
+    }
+
+    this->DST_OFFSET_X = (targetWidth - this->DST_WIDTH) / 2;
+    this->DST_OFFSET_Y = (targetHeight - this->DST_HEIGHT) / 2;
+
+    this->SUMS = new uint32_t[this->DST_WIDTH]();
+    this->COUNTS = new uint16_t[this->DST_WIDTH]();
+    this->ERROR_CURRENT = new int16_t[this->DST_WIDTH + 2]();
+    this->ERROR_NEXT = new int16_t[this->DST_WIDTH + 2]();
+    this->ROW = new uint8_t[(this->DST_WIDTH + 7) / 8];
+
+    // Count how many source columns end up in every destination column, the same for every row
+    uint32_t step = 0;
+    uint16_t column = 0;
+    for (uint32_t x = 0; x < width; x++)
+    {
+        this->COUNTS[column]++;
+
+        step += this->DST_WIDTH;
+        if (step >= width)
+        {
+            step -= width;
+            column++;
+        }
+    }
+}
+
+void ImageIngest::pixel(uint8_t value)
+{
+    // Scale to 0 - 255 and add to the destination column
+    this->SUMS[this->DST_X] += min((value * this->SCALE) >> 16, (uint32_t)255);
+
+    this->STEP_X += this->DST_WIDTH;
+    if (this->STEP_X >= this->SRC_WIDTH)
+    {
+        this->STEP_X -= this->SRC_WIDTH;
+        this->DST_X++;
+    }
+
+    // End of a source row
+    if (++this->SRC_X < this->SRC_WIDTH)
+    {
+        return;
+    }
+
+    this->SRC_X = 0;
+    this->DST_X = 0;
+    this->STEP_X = 0;
+    this->ROWS++;
+
+    this->STEP_Y += this->DST_HEIGHT;
+    if (this->STEP_Y >= this->SRC_HEIGHT)
+    {
+        this->STEP_Y -= this->SRC_HEIGHT;
+        this->emitRow();
+    }
+
+    if (++this->SRC_Y == this->SRC_HEIGHT)
+    {
+        this->STATE = ImageIngest::State::DONE;
+    }
+}
+
+void ImageIngest::emitRow()
+{
+    const uint16_t width = this->DST_WIDTH;
+    memset(this->ROW, 0, (width + 7) / 8);
+
+    for (uint16_t x = 0; x < width; x++)
+    {
+        // Box filter, average of all source pixels that ended up in this pixel
+        int16_t value = this->SUMS[x] / (this->COUNTS[x] * this->ROWS);
+        bool on;
+
+        switch (this->DITHER)
+        {
+        case ImageIngest::Dither::ORDERED:
+            on = value >= pgm_read_byte(&bayer[this->DST_Y & 0x03][x & 0x03]) * 16 + 8;
+            break;
+        case ImageIngest::Dither::FLOYD_STEINBERG:
+        {
+            // Error arrays have a margin of one column, x + 1 is the current pixel
+            value += this->ERROR_CURRENT[x + 1];
+            on = value >= 128;
+
+            const int16_t error = value - ((on) ? 255 : 0);
+            this->ERROR_CURRENT[x + 2] += (error * 7) >> 4;
+            this->ERROR_NEXT[x] += (error * 3) >> 4;
+            this->ERROR_NEXT[x + 1] += (error * 5) >> 4;
+            this->ERROR_NEXT[x + 2] += error >> 4;
+            break;
+        }
+        default:
+            on = value >= 128;
+            break;
+        }
+
+        if (on != this->INVERT)
+        {
+            this->ROW[x >> 3] |= 0x80 >> (x & 0x07);
+        }
+    }
+
+    // Pack the row, the target does not need to see the rest of the image for this
+    this->TARGET->setRow(this->ROW, width, this->DST_OFFSET_X, this->DST_OFFSET_Y + this->DST_Y, false);
+    this->DST_Y++;
+
+    // Prepare for the next row
+    memset(this->SUMS, 0, width * sizeof(uint32_t));
+    this->ROWS = 0;
+
+    int16_t *error = this->ERROR_CURRENT;
+    this->ERROR_CURRENT = this->ERROR_NEXT;
+    this->ERROR_NEXT = error;
+    memset(this->ERROR_NEXT, 0, (width + 2) * sizeof(int16_t));
+}
@@ -0,0 +1,151 @@
+/**
+ * @file image.hpp
+ * Converts a streamed grayscale image to the geometry of a display
+ *
+ * Accepts binary PGM (P5) images in chunks as they arrive. The image is downscaled to fit the display while keeping
+ * its aspect ratio using a fixed point box filter, dithered and packed into a MobiDOTBands buffer row by row.
+ * Only one row of column sums and two rows of dither error are kept in RAM.
+ *
+ * Arne van Iterson, 2023
+ */
+
+#ifndef _IMAGE_HPP_
+#define _IMAGE_HPP_
+
+#include <Arduino.h>
+
+#include "mobidot/bands.hpp"
+
+/**
+ * @class ImageIngest class
+ */
+class ImageIngest
+{
+public:
+    /**
+     * @enum Dither
+     * Contains the ways gray values are turned into dots
+     */
+    enum class Dither
+    {
+        THRESHOLD,
+        ORDERED,
+        FLOYD_STEINBERG
+    };
+
+    /**
+     * ImageIngest class constructor
+     * @param target Buffer to pack the result in, the image is centered in it
+     * @param dither Dither method
+     * @param invert Dark pixels become dots that are on if true, by default bright pixels are on
+     */
+    ImageIngest(MobiDOTBands &target, ImageIngest::Dither dither, bool invert = false);
+
+    /**
+     * ImageIngest class deconstructor
+     */
+    ~ImageIngest();
+
+    ImageIngest(const ImageIngest &) = delete;
+    ImageIngest &operator=(const ImageIngest &) = delete;
+
+    /**
+     * write function
+     * Processes the next chunk of the image file
+     * @param data Chunk data
+     * @param len Size of the chunk
+     * @returns False if the data is not a supported PGM image, all following data is ignored
+     */
+    bool write(const uint8_t data[], size_t len);
+
+    /**
+     * isFinished function
+     * @returns True once every pixel of the image has been processed
+     */
+    bool isFinished();
+
+private:
+    /**
+     * @enum State
+     * Parser states, the header fields follow each other
+     */
+    enum class State
+    {
+        MAGIC,
+        WIDTH,
+        HEIGHT,
+        MAXVAL,
+        PIXELS,
+        DONE,
+        FAILED
+    };
+
+    MobiDOTBands *TARGET;
+    ImageIngest::Dither DITHER;
+    bool INVERT;
+
+    // Header parser
+    ImageIngest::State STATE = ImageIngest::State::MAGIC;
+    uint32_t FIELD = 0;
+    bool FIELD_DIGITS = false;
+    bool COMMENT = false;
+
+    // Source image
+    uint16_t SRC_WIDTH = 0;
+    uint16_t SRC_HEIGHT = 0;
+    uint32_t SCALE = 0; // 16.16 factor from 0 - maxval to 0 - 255
+    uint16_t SRC_X = 0;
+    uint16_t SRC_Y = 0;
+
+    // Scaled image and its position in the target
+    uint16_t DST_WIDTH = 0;
+    uint16_t DST_HEIGHT = 0;
+    int16_t DST_OFFSET_X = 0;
+    int16_t DST_OFFSET_Y = 0;
+    uint16_t DST_X = 0;
+    uint16_t DST_Y = 0;
+
+    // Scaling accumulators, the destination advances when they wrap past the source size
+    uint32_t STEP_X = 0;
+    uint32_t STEP_Y = 0;
+
+    // Box filter sums of the current destination row and the amount of source pixels per column
+    uint32_t *SUMS = nullptr;
+    uint16_t *COUNTS = nullptr;
+    uint16_t ROWS = 0;
+
+    // Floyd-Steinberg error of the current and next row, 1 column margin on both sides
+    int16_t *ERROR_CURRENT = nullptr;
+    int16_t *ERROR_NEXT = nullptr;
+
+    // Packed output row
+    uint8_t *ROW = nullptr;
+
+    /**
+     * header function
+     * Handles a header byte
+     * @param value Input byte
+     */
+    void header(uint8_t value);
+
+    /**
+     * begin function
+     * Determines the scaled size and allocates the row buffers once the header is complete
+     */
+    void begin();
+
+    /**
+     * pixel function
+     * Adds a source pixel to the box filter
+     * @param value Gray value as stored in the file
+     */
+    void pixel(uint8_t value);
+
+    /**
+     * emitRow function
+     * Averages, dithers and packs the current destination row into the target
+     */
+    void emitRow();
+};
+
+#endif // _IMAGE_HPP_
@@ -0,0 +1,367 @@
+/**
+ * @file link.cpp
+ * Framed binary protocol to drive the displays over the USB serial port, for when there is no WiFi
+ *
+ * Arne van Iterson, 2023
+ */
+
+#include "./link.hpp"
+#include "mobidot/trace.hpp"
+
+SerialLink::SerialLink(MobiDOT &mobidot, Stream &stream)
+{
+    this->MOBIDOT = &mobidot;
+    this->STREAM = &stream;
+
+    for (uint i = 0; i < MOBIDOT_DISPLAY_COUNT; i++)
+    {
+        const MobiDOT::Display type = (MobiDOT::Display)i;
+        this->CONTENT[i] = new MobiDOTBands(mobidot.getWidth(type), mobidot.getHeight(type));
+    }
+}
+
+SerialLink::~SerialLink()
+{
+    for (uint i = 0; i < MOBIDOT_DISPLAY_COUNT; i++)
+    {
+        delete this->CONTENT[i];
+    }
+}
+
+void SerialLink::loop()
+{
+    // A frame waits until the frames before it on the same display are sent, the host waits for the ACK meanwhile
+    if (this->STATE == HOLD)
+    {
+        if (this->MOBIDOT->isBusy((MobiDOT::Display)this->getDisplay()))
+        {
+            return;
+        }
+
+        this->reply(this->handle());
+        this->STATE = SYNC_0;
+    }
+
+    // Drop a partial frame if the rest does not arrive
+    if (this->STATE != SYNC_0 && millis() - this->RECEIVED > SERIALLINK_TIMEOUT)
+    {
+        this->ERRORS++;
+        this->STATE = SYNC_0;
+    }
+
+    while (this->STREAM->available() > 0)
+    {
+        const int value = this->STREAM->read();
+        if (value < 0)
+        {
+            break;
+        }
+        this->RECEIVED = millis();
+
+        if (!this->receive(value))
+        {
+            continue;
+        }
+
+        // Complete frame
+        this->STATE = SYNC_0;
+        const Status status = this->check();
+        if (status != QUEUED)
+        {
+            this->ERRORS++;
+            this->reply(status);
+            continue;
+        }
+
+        if (this->getType() == HELLO)
+        {
+            this->SEQUENCE = -1;
+
+            uint8_t info[2 + 3 * MOBIDOT_DISPLAY_COUNT] = {SERIALLINK_VERSION, MOBIDOT_DISPLAY_COUNT};
+            for (uint i = 0; i < MOBIDOT_DISPLAY_COUNT; i++)
+            {
+                const MobiDOT::Display type = (MobiDOT::Display)i;
+                info[2 + i * 3] = this->MOBIDOT->getAddress(type);
+                info[3 + i * 3] = this->MOBIDOT->getWidth(type);
+                info[4 + i * 3] = this->MOBIDOT->getHeight(type);
+            }
+            this->reply(QUEUED, info, sizeof(info));
+            continue;
+        }
+
+        // The ACK of this frame got lost, the host sent it again
+        if (this->getSequence() == this->SEQUENCE)
+        {
+            this->reply(DUPLICATE);
+            continue;
+        }
+
+        // Stop reading, the next frame stays in the receive buffer of the port until this one is queued
+        if (this->MOBIDOT->isBusy((MobiDOT::Display)this->getDisplay()))
+        {
+            this->STATE = HOLD;
+            return;
+        }
+
+        this->reply(this->handle());
+    }
+}
+
+uint32_t SerialLink::getFrames()
+{
+    return this->FRAMES;
+}
+
+uint32_t SerialLink::getErrors()
+{
+    return this->ERRORS;
+}
+
+bool SerialLink::receive(uint8_t value)
+{
+    switch (this->STATE)
+    {
+    case SYNC_0:
+        if (value == SERIALLINK_SYNC_0)
+        {
+            this->STATE = SYNC_1;
+        }
+        return false;
+
+    case SYNC_1:
+        if (value == SERIALLINK_SYNC_1)
+        {
+            this->HEADER_DATA[0] = SERIALLINK_SYNC_0;
+            this->HEADER_DATA[1] = SERIALLINK_SYNC_1;
+            this->POSITION = 2;
+            this->STATE = HEADER;
+        }
+        else if (value != SERIALLINK_SYNC_0)
+        {
+            this->STATE = SYNC_0;
+        }
+        return false;
+
+    case HEADER:
+        this->HEADER_DATA[this->POSITION++] = value;
+        if (this->POSITION < SERIALLINK_HEADER_SIZE)
+        {
+            return false;
+        }
+
+        // A length this large can only be a damaged header, look for the next sync bytes
+        if (this->getLength() > SERIALLINK_PAYLOAD_SIZE)
+        {
+            this->ERRORS++;
+            this->STATE = SYNC_0;
+            return false;
+        }
+
+        this->POSITION = 0;
+        this->STATE = (this->getLength() > 0) ? PAYLOAD : CRC;
+        return false;
+
+    case PAYLOAD:
+        this->PAYLOAD_DATA[this->POSITION++] = value;
+        if (this->POSITION == this->getLength())
+        {
+            this->POSITION = 0;
+            this->STATE = CRC;
+        }
+        return false;
+
+    case CRC:
+        this->CRC_DATA[this->POSITION++] = value;
+        return this->POSITION == SERIALLINK_CRC_SIZE;
+
+    default:
+        return false;
+    }
+}
+
+SerialLink::Status SerialLink::check()
+{
+    uint16_t value = this->crc(0xffff, this->HEADER_DATA + 2, SERIALLINK_HEADER_SIZE - 2);
+    value = this->crc(value, this->PAYLOAD_DATA, this->getLength());
+    if (value != (this->CRC_DATA[0] | this->CRC_DATA[1] << 8))
+    {
+        return BAD_CRC;
+    }
+
+    if (this->getType() == HELLO)
+    {
+        return QUEUED;
+    }
+
+    if (this->getDisplay() >= MOBIDOT_DISPLAY_COUNT)
+    {
+        return BAD_DISPLAY;
+    }
+
+    const MobiDOT::Display type = (MobiDOT::Display)this->getDisplay();
+    const uint width = this->MOBIDOT->getWidth(type);
+    const uint height = this->MOBIDOT->getHeight(type);
+    const uint8_t *payload = this->PAYLOAD_DATA;
+    const uint length = this->getLength();
+
+    switch (this->getType())
+    {
+    case FULL:
+        return (length == height * ((width + 7) / 8)) ? QUEUED : BAD_PAYLOAD;
+
+    case DELTA:
+        // Every rectangle has to be complete
+        for (uint i = 0; i < length;)
+        {
+            if (length - i < 4)
+            {
+                return BAD_PAYLOAD;
+            }
+            const uint size = payload[i + 3] * ((payload[i + 2] + 7) / 8);
+            if (length - i - 4 < size)
+            {
+                return BAD_PAYLOAD;
+            }
+            i += 4 + size;
+        }
+        return QUEUED;
+
+    case RAW:
+        return (length >= 2 && payload[0] == MOBIDOT_BYTE_START && (char)payload[1] == this->MOBIDOT->getAddress(type))
+                   ? QUEUED
+                   : BAD_PAYLOAD;
+
+    default:
+        return BAD_TYPE;
+    }
+}
+
+SerialLink::Status SerialLink::handle()
+{
+    MOBIDOT_TRACE_SCOPE("linkFrame");
+    MobiDOT *mobidot = this->MOBIDOT;
+    const MobiDOT::Display type = (MobiDOT::Display)this->getDisplay();
+    const MobiDOT::Priority priority =
+        (this->getFlags() & SERIALLINK_FLAG_URGENT) ? MobiDOT::Priority::URGENT : MobiDOT::Priority::NORMAL;
+    MobiDOTBands &content = *this->CONTENT[(uint)type];
+    const uint8_t *payload = this->PAYLOAD_DATA;
+    const uint length = this->getLength();
+    Status status = QUEUED;
+
+    switch (this->getType())
+    {
+    case FULL:
+        content.drawBitmap(payload, mobidot->getWidth(type), mobidot->getHeight(type), 0, 0);
+        status = (mobidot->sendBands(type, content, 0, content.getWidth(), 0, 0, priority)) ? QUEUED : REFUSED;
+        break;
+
+    case DELTA:
+        for (uint i = 0; i < length;)
+        {
+            const uint width = payload[i + 2];
+            const uint height = payload[i + 3];
+            content.drawBitmap(payload + i + 4, width, height, payload[i], payload[i + 1]);
+            i += 4 + height * ((width + 7) / 8);
+        }
+
+        // The display is not busy, so the framebuffer is what the sign shows
+        {
+            const MobiDOTBands &shown = mobidot->getFramebuffer(type);
+            bool changed = false;
+            for (uint i = 0; i < content.getBands() && !changed; i++)
+            {
+                changed = memcmp(content.getBand(i), shown.getBand(i), content.getWidth()) != 0;
+            }
+
+            // Do not send an empty frame
+            if (!changed)
+            {
+                status = UNCHANGED;
+                break;
+            }
+
+            status = (mobidot->sendBandsChanged(type, content, 0, shown, 0, content.getWidth(), 0, 0, priority)) ? QUEUED : REFUSED;
+        }
+        break;
+
+    case RAW:
+        status = (mobidot->send((const char *)payload, length, priority)) ? QUEUED : REFUSED;
+        break;
+    }
+
+    if (status == QUEUED)
+    {
+        this->FRAMES++;
+    }
+    if (status != REFUSED)
+    {
+        this->SEQUENCE = this->getSequence();
+    }
+    else
+    {
+        this->ERRORS++;
+    }
+    return status;
+}
+
+void SerialLink::reply(SerialLink::Status status, const uint8_t payload[], uint size)
+{
+    const bool ack = status == QUEUED || status == UNCHANGED || status == DUPLICATE;
+    const uint length = 1 + size;
+    const uint8_t header[SERIALLINK_HEADER_SIZE] = {
+        SERIALLINK_SYNC_0, SERIALLINK_SYNC_1,
+        (uint8_t)((ack) ? ACK : NAK), 0, this->getDisplay(), this->getSequence(),
+        (uint8_t)length, (uint8_t)(length >> 8)};
+    const uint8_t value = status;
+
+    uint16_t check = this->crc(0xffff, header + 2, SERIALLINK_HEADER_SIZE - 2);
+    check = this->crc(check, &value, 1);
+    check = this->crc(check, payload, size);
+    const uint8_t footer[SERIALLINK_CRC_SIZE] = {(uint8_t)check, (uint8_t)(check >> 8)};
+
+    this->STREAM->write(header, sizeof(header));
+    this->STREAM->write(&value, 1);
+    if (size > 0)
+    {
+        this->STREAM->write(payload, size);
+    }
+    this->STREAM->write(footer, sizeof(footer));
+}
+
+uint16_t SerialLink::crc(uint16_t value, const uint8_t data[], uint size)
+{
+    for (uint i = 0; i < size; i++)
+    {
+        value ^= data[i] << 8;
+        for (uint bit = 0; bit < 8; bit++)
+        {
+            value = (value & 0x8000) ? (value << 1) ^ 0x1021 : value << 1;
+        }
+    }
+    return value;
+}
+
+uint8_t SerialLink::getType()
+{
+    return this->HEADER_DATA[2];
+}
+
+uint8_t SerialLink::getFlags()
+{
+    return this->HEADER_DATA[3];
+}
+
+uint8_t SerialLink::getDisplay()
+{
+    return this->HEADER_DATA[4];
+}
+
+uint8_t SerialLink::getSequence()
+{
+    return this->HEADER_DATA[5];
+}
+
+uint SerialLink::getLength()
+{
+    return this->HEADER_DATA[6] | this->HEADER_DATA[7] << 8;
+}
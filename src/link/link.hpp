@@ -0,0 +1,199 @@
+/**
+ * @file link.hpp
+ * Framed binary protocol to drive the displays over the USB serial port, for when there is no WiFi
+ *
+ * Every message, in both directions, looks like this (multi byte values little endian):
+ *   0xa5 0x5a | type | flags | display | sequence | length (2) | payload (length bytes) | CRC-16 (2)
+ * The CRC is CRC-16/CCITT-FALSE over type up to the end of the payload. The sync bytes let both sides skip anything
+ * else on the port, like the debug prints of main.cpp.
+ *
+ * Frames (host to board):
+ *   HELLO  Resets the sequence numbers, the ACK carries the protocol version, the amount of displays and the bus
+ *          address, width and height of every display
+ *   FULL   Complete bitmap of the display, rows of (width + 7) / 8 bytes, most significant bit first, 1 is on
+ *   DELTA  Rectangles applied on top of the last FULL or DELTA of the display: x, y, width, height and the bitmap
+ *          of the rectangle like FULL, repeated. Only the columns that differ from the sign are sent over the bus
+ *   RAW    Frame in wire format including header and footer, e.g. recorded by MobiDOT::onFrame()
+ * Flags: SERIALLINK_FLAG_URGENT sends the frame with priority URGENT.
+ *
+ * Every frame is answered with an ACK or NAK holding the sequence number of the frame and a status byte. A frame is
+ * only acknowledged once it is queued, and it is not queued while another frame for the same display is waiting or
+ * being sent. The host sends the next frame after the ACK, so the board holds at most one frame while the bus is
+ * busy: no frame is coalesced and the bus never runs dry. A frame with the same sequence number as the last one
+ * queued is acknowledged again without being queued, so the host can resend when an ACK got lost.
+ *
+ * Received frames are parsed in a fixed buffer, nothing is allocated per frame.
+ *
+ * Arne van Iterson, 2023
+ */
+
+#ifndef _LINK_HPP_
+#define _LINK_HPP_
+
+#include <Arduino.h>
+
+#include "mobidot/mobidot.hpp"
+#include "mobidot/bands.hpp"
+
+/* Protocol constants, tools/serial/client.cpp has a copy */
+#define SERIALLINK_VERSION 1
+#define SERIALLINK_SYNC_0 0xa5
+#define SERIALLINK_SYNC_1 0x5a
+#define SERIALLINK_HEADER_SIZE 8
+#define SERIALLINK_CRC_SIZE 2
+#define SERIALLINK_FLAG_URGENT 0x01
+
+/* Largest payload, a RAW frame can be as large as the display buffer */
+#define SERIALLINK_PAYLOAD_SIZE RS485_BUFFER_SIZE
+
+/* Time without bytes after which a partial frame is dropped, in milliseconds */
+#define SERIALLINK_TIMEOUT 100
+
+/**
+ * @class SerialLink class
+ */
+class SerialLink
+{
+public:
+    /**
+     * @enum Type
+     * Message types, replies have the highest bit set
+     */
+    enum Type
+    {
+        HELLO = 0x00,
+        FULL = 0x01,
+        DELTA = 0x02,
+        RAW = 0x03,
+        ACK = 0x80,
+        NAK = 0x81
+    };
+
+    /**
+     * @enum Status
+     * Status byte of an ACK or NAK
+     */
+    enum Status
+    {
+        QUEUED = 0,    // ACK: the frame was queued
+        UNCHANGED = 1, // ACK: the frame does not change the sign, nothing was queued
+        DUPLICATE = 2, // ACK: same sequence number as the last frame, it was queued before
+        BAD_CRC = 3,   // NAK: resend the frame
+        BAD_TYPE = 4,
+        BAD_DISPLAY = 5,
+        BAD_PAYLOAD = 6, // NAK: the size or content of the payload does not fit the type and display
+        REFUSED = 7      // NAK: the frame could not be queued
+    };
+
+    /**
+     * SerialLink class constructor
+     * @param mobidot Display controller to send the frames with
+     * @param stream Port the frames come in on, e.g. Serial. Give it a receive buffer of at least
+     * SERIALLINK_PAYLOAD_SIZE bytes, MobiDOT::loop() blocks while a chunk is written to the bus
+     */
+    SerialLink(MobiDOT &mobidot, Stream &stream);
+
+    /**
+     * SerialLink class deconstructor
+     */
+    ~SerialLink();
+
+    SerialLink(const SerialLink &) = delete;
+    SerialLink &operator=(const SerialLink &) = delete;
+
+    /**
+     * loop function
+     * Reads what was received and queues the frame once its display is free, call this from loop()
+     */
+    void loop();
+
+    /**
+     * getFrames, getErrors functions
+     * @returns Amount of frames queued, or amount of frames answered with a NAK and partial frames dropped
+     */
+    uint32_t getFrames();
+    uint32_t getErrors();
+
+private:
+    MobiDOT *MOBIDOT;
+    Stream *STREAM;
+
+    /**
+     * @enum State
+     * Position of the parser in a message
+     */
+    enum State
+    {
+        SYNC_0,
+        SYNC_1,
+        HEADER,
+        PAYLOAD,
+        CRC,
+        HOLD // A complete frame waits for its display
+    };
+
+    State STATE = SYNC_0;
+    uint8_t HEADER_DATA[SERIALLINK_HEADER_SIZE];
+    uint8_t PAYLOAD_DATA[SERIALLINK_PAYLOAD_SIZE];
+    uint8_t CRC_DATA[SERIALLINK_CRC_SIZE];
+    uint POSITION = 0;
+    unsigned long RECEIVED = 0; // Time of the last byte
+
+    // Sequence number of the last frame queued, -1 after HELLO
+    int SEQUENCE = -1;
+
+    // Content of every display according to the FULL and DELTA frames received
+    MobiDOTBands *CONTENT[MOBIDOT_DISPLAY_COUNT];
+
+    uint32_t FRAMES = 0;
+    uint32_t ERRORS = 0;
+
+    /**
+     * receive function
+     * Feeds a byte to the parser
+     * @returns True if a complete frame was received
+     */
+    bool receive(uint8_t value);
+
+    /**
+     * check function
+     * Validates a complete frame
+     * @returns QUEUED if the frame can be handled, otherwise the NAK status
+     */
+    Status check();
+
+    /**
+     * handle function
+     * Queues a complete, valid frame
+     * @returns Status for the ACK or NAK
+     */
+    Status handle();
+
+    /**
+     * reply function
+     * Sends an ACK or NAK for the current frame
+     * @param status Status byte, decides between ACK and NAK
+     * @param payload Additional payload (optional)
+     * @param size Size of the additional payload
+     */
+    void reply(Status status, const uint8_t payload[] = nullptr, uint size = 0);
+
+    /**
+     * crc function
+     * CRC-16/CCITT-FALSE, continues from the given CRC so messages can be checked in parts
+     * @param value CRC so far, 0xffff to start
+     * @param data Data to add
+     * @param size Size of the data
+     * @returns CRC including the data
+     */
+    static uint16_t crc(uint16_t value, const uint8_t data[], uint size);
+
+    // Fields of the header
+    uint8_t getType();
+    uint8_t getFlags();
+    uint8_t getDisplay();
+    uint8_t getSequence();
+    uint getLength();
+};
+
+#endif // _LINK_HPP_
@@ -1,67 +1,222 @@
 #include <iostream>
 #include <string>
+#include <memory>
 #include <Arduino.h>
 #include <WiFiClient.h>
-#include <ESP8266WiFiMulti.h>
+#include <ESP8266WiFi.h>
 #include <ESPAsyncTCP.h>
 #include <ESPAsyncWebServer.h>
 #include <LittleFS.h>
-#include <base64.hpp>
 
 #include "mobidot/mobidot.hpp"
+#include "framestore/framestore.hpp"
+#include "framespill/framespill.hpp"
+#include "upload/upload.hpp"
+#include "image/image.hpp"
+#include "command/command.hpp"
+#include "link/link.hpp"
+#include "mobidot/bands.hpp"
+#include "mobidot/trace.hpp"
 
 AsyncWebServer server(80);
 
+// Pushes framebuffer changes to every connected browser
+AsyncEventSource events("/events");
+
+// Frame versions start at 0 again after a reboot, browsers tell the boots apart by this id
+uint32_t bootId = 0;
+
 MobiDOT MobiDOT(/* rx */ D6, /* tx */ D5, /* ctrl */ D4, /* light */ D7);
 
 // Compile time
 const char compile_date[] = __DATE__ " " __TIME__;
 #define DEBUG_BAUDRATE 115200
 
-// Wifi init
-ESP8266WiFiMulti WiFiMulti;
+// What every display shows, stored once it settles and sent again on boot
+FrameStore frameStore;
+
+// Content file uploads to LittleFS
+ContentUpload contentUpload;
+
+// Image ingest, one image at a time
+AsyncWebServerRequest *imageRequest = nullptr;
+MobiDOT::Display imageDisplay = MobiDOT::Display::REAR;
+MobiDOTBands *imageBands = nullptr;
+ImageIngest *imageIngest = nullptr;
 
-// Display buffer for online update
-const uint16_t bufferLength = MOBIDOT_HEIGHT_REAR * ceil(MOBIDOT_WIDTH_REAR / 8.0);
-unsigned char buffer[bufferLength] = {0};
+// Wifi init, connecting happens in the background, the webserver is started from loop() once connected
+#define WIFI_SSID "Langeboomgaard"
+#define WIFI_PASSWORD "ACvI4152EK"
+bool online = false;
 
-// SERIAL RECEIVE VARS
-#define LF 0x0A
+// Frames that were sent before are not encoded again, frames evicted from RAM go to LittleFS
+FrameSpill frameSpill;
+MobiDOTFrameCache frameCache(MobiDOT, &frameSpill);
+
+// Command handling, shared with the host server in tools/loadtest
+CommandCore commandCore(MobiDOT, &frameCache);
+
+// Frames from an onboard PC over the USB serial port, shares the port with the debug prints
+SerialLink serialLink(MobiDOT, Serial);
+
+/**
+ * @class RequestArgs class
+ * Parameters of a command, read from the body or the query string of a request
+ */
+class RequestArgs : public CommandArgs
+{
+public:
+    RequestArgs(AsyncWebServerRequest *request) : REQUEST(request) {}
+
+    const char *get(const char *name) const override
+    {
+        if (this->REQUEST->hasParam(name, true))
+        {
+            return this->REQUEST->getParam(name, true)->value().c_str();
+        }
+        if (this->REQUEST->hasParam(name))
+        {
+            return this->REQUEST->getParam(name)->value().c_str();
+        }
+        return nullptr;
+    }
+
+private:
+    AsyncWebServerRequest *REQUEST;
+};
+
+/**
+ * Runs a command of the CommandCore and sends its response
+ */
+void runCommand(AsyncWebServerRequest *request, const char *name)
+{
+    MOBIDOT_TRACE_SCOPE(name);
+
+    char response[COMMAND_RESPONSE_SIZE];
+    const int status = commandCore.execute(name, RequestArgs(request), response, sizeof(response));
+    request->send(status, "text/json", response);
+}
+
+/**
+ * Reads the 'display' parameter of a request (front, rear or side)
+ * Returns false if the parameter is missing or unknown
+ */
+bool getDisplay(AsyncWebServerRequest *request, MobiDOT::Display &type)
+{
+    if (!request->hasParam("display"))
+    {
+        return false;
+    }
+
+    const String &value = request->getParam("display")->value();
+    if (value == "front")
+    {
+        type = MobiDOT::Display::FRONT;
+    }
+    else if (value == "rear")
+    {
+        type = MobiDOT::Display::REAR;
+    }
+    else if (value == "side")
+    {
+        type = MobiDOT::Display::SIDE;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
 
-char angle_str[10];
-int idx = 0;
-bool state = false;
+/**
+ * Name of a display as used in the 'display' parameter
+ */
+const char *displayName(MobiDOT::Display type)
+{
+    switch (type)
+    {
+    case MobiDOT::Display::FRONT:
+        return "front";
+    case MobiDOT::Display::SIDE:
+        return "side";
+    default:
+        return "rear";
+    }
+}
 
-void dumpBuffer()
+/**
+ * Sends the bands of a framebuffer that changed with the last frame to all event clients
+ * data holds the columns of every changed band as hex, one byte per column (001xxxxx, bit 0 is the top row)
+ */
+void pushFrame(MobiDOT::Display type)
 {
-    for (size_t i = 0; i < bufferLength; i++)
+    const uint8_t changed = MobiDOT.getChangedBands(type);
+    if (changed == 0 || events.count() == 0)
     {
-        if ((i % (int)ceil(MOBIDOT_WIDTH_REAR / 8.0)) == 0)
+        return;
+    }
+
+    const MobiDOTBands &framebuffer = MobiDOT.getFramebuffer(type);
+    const uint32_t version = MobiDOT.getFrameVersion(type);
+
+    String json;
+    json.reserve(64 + framebuffer.getBands() * (framebuffer.getWidth() * 2 + 8));
+
+    char header[112];
+    snprintf(header, sizeof(header),
+             "{\"display\":\"%s\",\"width\":%u,\"height\":%u,\"boot\":\"%08x\",\"version\":%u,\"bands\":{",
+             displayName(type), framebuffer.getWidth(), framebuffer.getHeight(), bootId, version);
+    json += header;
+
+    bool first = true;
+    for (uint i = 0; i < framebuffer.getBands(); i++)
+    {
+        if (!(changed >> i & 0x01))
         {
-            Serial.println();
+            continue;
         }
 
-        for (size_t bit = 0; bit < 8; bit++)
+        json += (first) ? "\"" : ",\"";
+        json += i;
+        json += "\":\"";
+
+        const uint8_t *band = framebuffer.getBand(i);
+        for (uint j = 0; j < framebuffer.getWidth(); j++)
         {
-            Serial.print(buffer[i] & (1 << bit) ? "1" : "0");
+            char hex[3];
+            snprintf(hex, sizeof(hex), "%02x", band[j]);
+            json += hex;
         }
+        json += "\"";
+        first = false;
     }
+    json += "}}";
+
+    events.send(json.c_str(), "frame", version);
 }
 
-uint8_t h2d(char hex) {
-    if(hex > 0x39) hex -= 7; // adjust for hex letters upper or lower case
-    return(hex & 0xf);
+void endImage()
+{
+    delete imageIngest;
+    delete imageBands;
+    imageIngest = nullptr;
+    imageBands = nullptr;
+    imageRequest = nullptr;
 }
 
 void setup()
 {
-    // Serial setup
+    // Serial setup, the receive buffer holds a complete frame of the serial link while the bus blocks loop()
+    Serial.setRxBufferSize(SERIALLINK_HEADER_SIZE + SERIALLINK_PAYLOAD_SIZE + SERIALLINK_CRC_SIZE);
     Serial.begin(DEBUG_BAUDRATE);
     delay(10);
 
     // Print firmware version
     Serial.println(compile_date);
 
+    // Hardware random number, so an ETag or event of the previous boot never matches
+    bootId = RANDOM_REG32;
+
     // Begin LittleFS
     if (!LittleFS.begin())
     {
@@ -69,21 +224,27 @@ void setup()
         return;
     }
 
-    // Wifi setup
+    // Show the last frames before doing anything slow
+    MobiDOT.onFrame(
+        [](MobiDOT::Display type, const char[], uint)
+        {
+            pushFrame(type);
+        });
+    MobiDOT.selectDisplay(MobiDOT::Display::REAR);
+    MobiDOT.toggleLight();
+
+    Serial.print(F("Frames restored: "));
+    Serial.println(frameStore.replay(MobiDOT));
+
+    // Wifi setup, does not wait for the connection
     WiFi.mode(WIFI_STA);
     WiFi.persistent(true);
-    WiFiMulti.addAP("Langeboomgaard", "ACvI4152EK");
+    WiFi.setAutoReconnect(true);
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
 
-    Serial.print(F("\nWifi connecting"));
-    while (WiFiMulti.run() != WL_CONNECTED)
-    {
-        Serial.print(".");
-        delay(500);
-    }
+    Serial.println(F("Wifi connecting"));
 
-    Serial.println(F("IP address: "));
-    Serial.println(WiFi.localIP());
-    Serial.println(bufferLength);
+    server.addHandler(&events);
 
     server.on(
         "/",
@@ -109,50 +270,191 @@ void setup()
             request->send(LittleFS, "/index.js", "application/javascript");
         });
 
+    // Stream a content file into LittleFS, either as multipart form or raw body
+    // POST /upload?path=/fonts/name.bin&crc=cbf43926
     server.on(
-        "/command/toggleLight",
+        "/upload",
         HTTP_POST,
         [](AsyncWebServerRequest *request)
         {
-            MobiDOT.toggleLight();
-            request->send(200, "text/json", "{}");
+            contentUpload.respond(request);
+        },
+        [](AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final)
+        {
+            contentUpload.chunk(request, filename.c_str(), index, data, len);
+        },
+        [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+        {
+            contentUpload.chunk(request, nullptr, index, data, len);
         });
 
+    // Convert a grayscale image to a display and show it
+    // POST /command/image?display=rear&dither=fs with a binary PGM (P5) body sent as application/octet-stream
+    // dither is one of none, ordered or fs (default)
     server.on(
-        "/command/base64",
+        "/command/image",
         HTTP_POST,
         [](AsyncWebServerRequest *request)
         {
-            // Serial.println("base64 upload");
-            // Serial.println(request->getParam(0)->value());
-
-            unsigned char data[bufferLength * 2] = {0}; // (*2) Every character represents a nibble so we need twice as many
-            decode_base64((unsigned char*)request->getParam(0)->value().c_str(), data);
-            // Serial.println((char*)data);
+            if (imageRequest != request)
+            {
+                request->send((imageRequest == nullptr) ? 400 : 409, "text/json", "{}");
+                return;
+            }
 
-            for (size_t i = 0; i < bufferLength * 2; i = i + 2) // (*2) See above
+            if (!imageIngest->isFinished())
             {
-                buffer[i / 2] = (h2d(data[i]) << 4) + h2d(data[i + 1]);
+                endImage();
+                request->send(400, "text/json", "{}");
+                return;
             }
 
+            MobiDOT.selectDisplay(imageDisplay);
+            MobiDOT.drawBands(*imageBands);
+            MobiDOT.update();
+            endImage();
+
             request->send(200, "text/json", "{}");
+        },
+        nullptr,
+        [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+        {
+            if (index == 0)
+            {
+                if (imageRequest != nullptr || !getDisplay(request, imageDisplay))
+                {
+                    return;
+                }
+
+                ImageIngest::Dither dither = ImageIngest::Dither::FLOYD_STEINBERG;
+                if (request->hasParam("dither"))
+                {
+                    const String &value = request->getParam("dither")->value();
+                    if (value == "none")
+                    {
+                        dither = ImageIngest::Dither::THRESHOLD;
+                    }
+                    else if (value == "ordered")
+                    {
+                        dither = ImageIngest::Dither::ORDERED;
+                    }
+                }
+
+                imageRequest = request;
+                imageBands = new MobiDOTBands(MobiDOT.getWidth(imageDisplay), MobiDOT.getHeight(imageDisplay));
+                imageIngest = new ImageIngest(*imageBands, dither);
+
+                request->onDisconnect(
+                    [request]()
+                    {
+                        if (imageRequest == request)
+                        {
+                            endImage();
+                        }
+                    });
+            }
+
+            if (imageRequest == request)
+            {
+                MOBIDOT_TRACE_SCOPE("image ingest");
+                imageIngest->write(data, len);
+            }
         });
 
+    // Current content of a display: width, height and the rows padded to full bytes (MSB first)
+    // GET /framebuffer?display=rear, supports If-None-Match with the ETag
     server.on(
-        "/command/update",
-        HTTP_POST,
+        "/framebuffer",
+        HTTP_GET,
         [](AsyncWebServerRequest *request)
         {
-            Serial.println("display update");
-            // dumpBuffer();
+            MobiDOT::Display type;
+            if (!getDisplay(request, type))
+            {
+                request->send(400, "text/json", "{}");
+                return;
+            }
 
-            MobiDOT.drawBitmap(buffer, MOBIDOT_WIDTH_REAR, MOBIDOT_HEIGHT_REAR, true);
-            MobiDOT.update();
-            request->send(200, "text/json", "{}");
+            char etag[40];
+            snprintf(etag, sizeof(etag), "\"%s-%08x-%u\"", displayName(type), bootId, MobiDOT.getFrameVersion(type));
+
+            if (request->hasHeader("If-None-Match") && request->getHeader("If-None-Match")->value() == etag)
+            {
+                request->send(304);
+                return;
+            }
 
-            memset(&buffer, 0, bufferLength);
+            const MobiDOTBands &framebuffer = MobiDOT.getFramebuffer(type);
+            const uint width = framebuffer.getWidth();
+            const uint height = framebuffer.getHeight();
+
+            AsyncResponseStream *response = request->beginResponseStream("application/octet-stream");
+            response->addHeader("ETag", etag);
+            response->write((uint8_t)width);
+            response->write((uint8_t)height);
+
+            for (uint y = 0; y < height; y++)
+            {
+                uint8_t value = 0;
+                for (uint x = 0; x < width; x++)
+                {
+                    value |= framebuffer.getPixel(x, y) << (7 - (x % 8));
+                    if (x % 8 == 7 || x == width - 1)
+                    {
+                        response->write(value);
+                        value = 0;
+                    }
+                }
+            }
+
+            request->send(response);
         });
 
+    // Transmitter statistics, see CommandCore::status()
+    server.on(
+        "/status",
+        HTTP_GET,
+        [](AsyncWebServerRequest *request)
+        {
+            runCommand(request, "status");
+        });
+
+#ifdef MOBIDOT_TRACE
+    // Recorded trace events as Chrome trace JSON, open in about:tracing or ui.perfetto.dev
+    // GET /trace, add ?clear to start over afterwards
+    server.on(
+        "/trace",
+        HTTP_GET,
+        [](AsyncWebServerRequest *request)
+        {
+            std::shared_ptr<MobiDOTTraceExport> trace = std::make_shared<MobiDOTTraceExport>();
+            if (request->hasParam("clear"))
+            {
+                MobiDOTTrace::clear();
+            }
+
+            request->send(request->beginChunkedResponse(
+                "application/json",
+                [trace](uint8_t *buffer, size_t maxLen, size_t index)
+                {
+                    return trace->read(buffer, maxLen);
+                }));
+        });
+#endif
+
+    // POST /command/<name>, see command.hpp
+    for (uint i = 0; i < CommandCore::getCount(); i++)
+    {
+        const char *name = CommandCore::getName(i);
+        server.on(
+            (String("/command/") + name).c_str(),
+            HTTP_POST,
+            [name](AsyncWebServerRequest *request)
+            {
+                runCommand(request, name);
+            });
+    }
+
     // server.on(
     //     "/command/bitmap",
     //     HTTP_POST,
@@ -168,15 +470,27 @@ void setup()
     //             buffer[index] = value;
     //         }
     //     });
-
-    server.begin();
-
-    // Display setup
-    MobiDOT.selectDisplay(MobiDOT::Display::REAR);
-    MobiDOT.toggleLight();
-    MobiDOT.update();
 }
 
 void loop()
 {
+    // Send queued frames, a chunk at a time
+    MobiDOT.loop();
+
+    // Queue frames received over the serial port
+    serialLink.loop();
+
+    // Store what the displays show once it settles, never from the frame callback inside MobiDOT.loop()
+    frameStore.loop(MobiDOT);
+
+    // Start the webserver as soon as the connection is up
+    if (!online && WiFi.status() == WL_CONNECTED)
+    {
+        online = true;
+
+        Serial.println(F("IP address: "));
+        Serial.println(WiFi.localIP());
+
+        server.begin();
+    }
 }
\ No newline at end of file
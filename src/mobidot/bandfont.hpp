@@ -0,0 +1,185 @@
+/**
+ * @file bandfont.hpp
+ * Compile time conversion of GFXfonts into band packed tables for the MobiDOT display library
+ *
+ * GFXfonts store every glyph row by row, print() has to read them byte by byte from flash and transpose them into
+ * the column layout of the display for every character. A MobiDOTBandFont is converted by the compiler instead:
+ * every column of every glyph is one 32 bit word where bit r is row r of the font cell, stored word aligned in flash.
+ * Printing then takes one aligned word read per column. Glyphs that reach left of the cursor or beyond their xAdvance
+ * (italics, kerned fonts) keep those columns, they are combined with the neighbouring glyph when printing.
+ *
+ * Usage, the bitmap and glyph arrays of the font header have to be declared constexpr instead of const:
+ *   constexpr uint8_t FreeSans9pt7bBitmaps[] PROGMEM = {...};
+ *   constexpr GFXglyph FreeSans9pt7bGlyphs[] PROGMEM = {...};
+ *   MOBIDOT_BAND_FONT(FreeSans9pt7bBands, FreeSans9pt7bBitmaps, FreeSans9pt7bGlyphs, 0x20);
+ *   MobiDOT.print("Hello", FreeSans9pt7bBands);
+ * gfxfont/tiny3x5.h is written this way, tools/bandfont/check.cpp converts it.
+ *
+ * Copyright (c) 2021 Arne van Iterson
+ */
+
+#ifndef _MOBIDOT_BANDFONT_HPP_
+#define _MOBIDOT_BANDFONT_HPP_
+
+#include <Arduino.h>
+#include "gfxfont/gfxfont.h"
+
+/**
+ * @struct MobiDOTBandFont
+ * Points to the tables of a converted font, this is what MobiDOT::print() takes
+ */
+struct MobiDOTBandFont
+{
+    const uint32_t *columns; // One word per column, bit r is row r of the font cell
+    const uint32_t *glyphs;  // One word per glyph plus one, index of its first column << 16 | x of that column << 8 | xAdvance
+    uint16_t first;          // ASCII extents (first char)
+    uint16_t last;           // ASCII extents (last char)
+    uint8_t height;          // Height of the font cell in rows
+};
+
+/**
+ * @struct MobiDOTBandFontTable
+ * Storage of a converted font, created by MOBIDOT_BAND_FONT
+ */
+template <size_t Columns, size_t Glyphs>
+struct MobiDOTBandFontTable
+{
+    alignas(4) uint32_t columns[Columns];
+    alignas(4) uint32_t glyphs[Glyphs + 1]; // The last word only holds the index after the last column
+};
+
+namespace MobiDOTBandFontBuilder
+{
+    /**
+     * start and end functions
+     * @returns First column and the column after the last of a glyph relative to the cursor, covering both its
+     * xAdvance and its pixels
+     */
+    constexpr int start(const GFXglyph &glyph)
+    {
+        return (glyph.width && glyph.height && glyph.xOffset < 0) ? glyph.xOffset : 0;
+    }
+
+    constexpr int end(const GFXglyph &glyph)
+    {
+        return (glyph.width && glyph.height && glyph.xOffset + glyph.width > glyph.xAdvance)
+                   ? glyph.xOffset + glyph.width
+                   : glyph.xAdvance;
+    }
+
+    /**
+     * columns function
+     * @returns Total amount of columns of all glyphs
+     */
+    template <size_t G>
+    constexpr size_t columns(const GFXglyph (&glyphs)[G])
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < G; i++)
+        {
+            count += end(glyphs[i]) - start(glyphs[i]);
+        }
+        return count;
+    }
+
+    /**
+     * top function
+     * @returns Highest row any glyph reaches relative to the baseline
+     */
+    template <size_t G>
+    constexpr int top(const GFXglyph (&glyphs)[G])
+    {
+        int value = 0;
+        for (size_t i = 0; i < G; i++)
+        {
+            if (glyphs[i].height && glyphs[i].yOffset < value)
+            {
+                value = glyphs[i].yOffset;
+            }
+        }
+        return value;
+    }
+
+    /**
+     * height function
+     * @returns Height of the font cell, from the top of the highest glyph to the bottom of the lowest
+     */
+    template <size_t G>
+    constexpr int height(const GFXglyph (&glyphs)[G])
+    {
+        int bottom = 0;
+        for (size_t i = 0; i < G; i++)
+        {
+            if (glyphs[i].height && glyphs[i].yOffset + glyphs[i].height > bottom)
+            {
+                bottom = glyphs[i].yOffset + glyphs[i].height;
+            }
+        }
+        return bottom - top(glyphs);
+    }
+
+    /**
+     * build function
+     * Transposes all glyphs into columns
+     * @returns Converted tables
+     */
+    template <size_t C, size_t G, size_t B>
+    constexpr MobiDOTBandFontTable<C, G> build(const uint8_t (&bitmap)[B], const GFXglyph (&glyphs)[G])
+    {
+        MobiDOTBandFontTable<C, G> table{};
+        const int cellTop = top(glyphs);
+
+        size_t column = 0;
+        for (size_t i = 0; i < G; i++)
+        {
+            const GFXglyph &g = glyphs[i];
+            const int first = start(g);
+            table.glyphs[i] = (uint32_t)column << 16 | (uint8_t)first << 8 | g.xAdvance;
+
+            // Glyph bits are stored row after row without padding
+            size_t bit = 0;
+            for (int row = 0; row < g.height; row++)
+            {
+                for (int col = 0; col < g.width; col++, bit++)
+                {
+                    const int x = g.xOffset + col - first;
+                    const int y = g.yOffset - cellTop + row;
+
+                    if (bitmap[g.bitmapOffset + bit / 8] >> (7 - bit % 8) & 0x01)
+                    {
+                        table.columns[column + x] |= (uint32_t)1 << y;
+                    }
+                }
+            }
+
+            column += end(g) - first;
+        }
+        table.glyphs[G] = (uint32_t)column << 16;
+
+        return table;
+    }
+}
+
+/**
+ * MOBIDOT_BAND_FONT macro
+ * Converts a GFXfont at compile time and defines a MobiDOTBandFont called name pointing to the tables in flash
+ * @param name Name of the MobiDOTBandFont
+ * @param fontBitmap constexpr bitmap array of the GFXfont
+ * @param fontGlyphs constexpr glyph array of the GFXfont
+ * @param first First char of the font
+ */
+#define MOBIDOT_BAND_FONT(name, fontBitmap, fontGlyphs, first)                                                             \
+    static_assert(MobiDOTBandFontBuilder::height(fontGlyphs) <= 32, "Font cells can not be higher than 32 rows");          \
+    static_assert(MobiDOTBandFontBuilder::columns(fontGlyphs) <= 0xffff, "Fonts can not have more than 65535 columns");    \
+    static constexpr auto name##Table PROGMEM =                                                                            \
+        MobiDOTBandFontBuilder::build<MobiDOTBandFontBuilder::columns(fontGlyphs), sizeof(fontGlyphs) / sizeof(GFXglyph)>( \
+            fontBitmap, fontGlyphs);                                                                                       \
+    static const MobiDOTBandFont name = {                                                                                  \
+        name##Table.columns,                                                                                               \
+        name##Table.glyphs,                                                                                                \
+        (first),                                                                                                           \
+        (first) + sizeof(fontGlyphs) / sizeof(GFXglyph) - 1,                                                               \
+        MobiDOTBandFontBuilder::height(fontGlyphs),                                                                        \
+    }
+
+#endif // _MOBIDOT_BANDFONT_HPP_
@@ -0,0 +1,199 @@
+/**
+ * @file bands.cpp
+ * Band packed pixel buffer for the MobiDOT display library
+ *
+ * Copyright (c) 2021 Arne van Iterson
+ */
+
+#include "./bands.hpp"
+
+MobiDOTBands::MobiDOTBands(uint width, uint height)
+{
+    this->WIDTH = width;
+    this->HEIGHT = height;
+    this->BANDS = (height + MOBIDOT_BAND_HEIGHT - 1) / MOBIDOT_BAND_HEIGHT;
+
+    this->DATA = new uint8_t[this->BANDS * this->WIDTH];
+    this->clear();
+}
+
+MobiDOTBands::~MobiDOTBands()
+{
+    delete[] this->DATA;
+}
+
+uint MobiDOTBands::getWidth() const
+{
+    return this->WIDTH;
+}
+
+uint MobiDOTBands::getHeight() const
+{
+    return this->HEIGHT;
+}
+
+uint MobiDOTBands::getBands() const
+{
+    return this->BANDS;
+}
+
+uint8_t *MobiDOTBands::getBand(uint band)
+{
+    return this->DATA + band * this->WIDTH;
+}
+
+const uint8_t *MobiDOTBands::getBand(uint band) const
+{
+    return this->DATA + band * this->WIDTH;
+}
+
+void MobiDOTBands::clear(bool value)
+{
+    memset(this->DATA, (value) ? MOBIDOT_BAND_EMPTY | MOBIDOT_BAND_MASK : MOBIDOT_BAND_EMPTY, this->BANDS * this->WIDTH);
+}
+
+void MobiDOTBands::setPixel(int x, int y, bool value)
+{
+    if (x < 0 || y < 0 || x >= (int)this->WIDTH || y >= (int)this->HEIGHT)
+    {
+        return;
+    }
+
+    uint8_t *column = this->DATA + (y / MOBIDOT_BAND_HEIGHT) * this->WIDTH + x;
+    const uint8_t bit = 0x01 << (y % MOBIDOT_BAND_HEIGHT);
+
+    if (value)
+    {
+        *column |= bit;
+    }
+    else
+    {
+        *column &= ~bit;
+    }
+}
+
+bool MobiDOTBands::getPixel(int x, int y) const
+{
+    if (x < 0 || y < 0 || x >= (int)this->WIDTH || y >= (int)this->HEIGHT)
+    {
+        return false;
+    }
+
+    const uint8_t column = this->DATA[(y / MOBIDOT_BAND_HEIGHT) * this->WIDTH + x];
+    return column >> (y % MOBIDOT_BAND_HEIGHT) & 0x01;
+}
+
+void MobiDOTBands::setRow(const unsigned char data[], uint width, int x, int y, bool invert)
+{
+    if (y < 0 || y >= (int)this->HEIGHT)
+    {
+        return;
+    }
+
+    // Every pixel of the row ends up in the same bit of a column byte
+    uint8_t *band = this->DATA + (y / MOBIDOT_BAND_HEIGHT) * this->WIDTH;
+    const uint8_t bit = 0x01 << (y % MOBIDOT_BAND_HEIGHT);
+
+    // Clip the row to the buffer
+    const int start = (x < 0) ? -x : 0;
+    const int end = min((int)width, (int)this->WIDTH - x);
+
+    for (int i = start; i < end; i++)
+    {
+        const bool value = (data[i >> 3] >> (7 - (i & 0x07)) & 0x01) != invert;
+
+        if (value)
+        {
+            band[x + i] |= bit;
+        }
+        else
+        {
+            band[x + i] &= ~bit;
+        }
+    }
+}
+
+void MobiDOTBands::drawBitmap(const unsigned char data[], uint width, uint height, int x, int y, bool invert)
+{
+    const uint bytesOverWidth = (width + 7) / 8;
+
+    for (uint row = 0; row < height; row++)
+    {
+        this->setRow(data + row * bytesOverWidth, width, x, y + row, invert);
+    }
+}
+
+uint MobiDOTBands::print(const char c[], const GFXfont *font, int x, int y, bool invert)
+{
+    const uint16_t first = pgm_read_word(&font->first);
+    const uint16_t last = pgm_read_word(&font->last);
+    const uint8_t *bitmap = (const uint8_t *)pgm_read_ptr(&font->bitmap);
+    const GFXglyph *glyphs = (const GFXglyph *)pgm_read_ptr(&font->glyph);
+    const size_t length = strlen(c);
+
+    // Find the top of the highest glyph so the string starts at y
+    int8_t top = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        const uint8_t index = ((uint8_t)c[i] >= first && (uint8_t)c[i] <= last) ? c[i] - first : 0x20 - first;
+        const int8_t yOffset = pgm_read_byte(&glyphs[index].yOffset);
+        if (yOffset < top)
+        {
+            top = yOffset;
+        }
+    }
+
+    int cursor = x;
+    for (size_t i = 0; i < length; i++)
+    {
+        // Make sure that the selected char is in the scope of the font, otherwise display a space
+        const uint8_t index = ((uint8_t)c[i] >= first && (uint8_t)c[i] <= last) ? c[i] - first : 0x20 - first;
+        const GFXglyph *g = glyphs + index;
+
+        const uint16_t bitmapOffset = pgm_read_word(&g->bitmapOffset);
+        const uint8_t charW = pgm_read_byte(&g->width);
+        const uint8_t charH = pgm_read_byte(&g->height);
+        const uint8_t charXadvance = pgm_read_byte(&g->xAdvance);
+        const int8_t charXoffset = pgm_read_byte(&g->xOffset);
+        const int8_t charYoffset = pgm_read_byte(&g->yOffset);
+
+        // Glyph bits are stored row after row without padding
+        uint16_t bit = 0;
+        uint8_t bits = 0;
+        for (uint8_t row = 0; row < charH; row++)
+        {
+            for (uint8_t col = 0; col < charW; col++, bit++)
+            {
+                if ((bit & 0x07) == 0)
+                {
+                    bits = pgm_read_byte(&bitmap[bitmapOffset + (bit >> 3)]);
+                }
+
+                if (bits & 0x80)
+                {
+                    this->setPixel(cursor + charXoffset + col, y + charYoffset - top + row, !invert);
+                }
+                bits <<= 1;
+            }
+        }
+
+        cursor += charXadvance;
+    }
+
+    return cursor - x;
+}
+
+uint MobiDOTBands::textWidth(const char c[], const GFXfont *font)
+{
+    const uint16_t first = pgm_read_word(&font->first);
+    const uint16_t last = pgm_read_word(&font->last);
+    const GFXglyph *glyphs = (const GFXglyph *)pgm_read_ptr(&font->glyph);
+
+    uint width = 0;
+    for (size_t i = 0; i < strlen(c); i++)
+    {
+        const uint8_t index = ((uint8_t)c[i] >= first && (uint8_t)c[i] <= last) ? c[i] - first : 0x20 - first;
+        width += pgm_read_byte(&glyphs[index].xAdvance);
+    }
+    return width;
+}
@@ -0,0 +1,133 @@
+/**
+ * @file bands.hpp
+ * Band packed pixel buffer for the MobiDOT display library
+ *
+ * MobiDOT displays are written in bands of 5 rows, every column of a band is one byte in the BITWISE font:
+ * 001xxxxx where bit 0 is the top row of the band. This buffer stores pixels in exactly that layout,
+ * so drawing it to a display is a copy instead of a conversion.
+ *
+ * Copyright (c) 2021 Arne van Iterson
+ */
+
+#ifndef _MOBIDOT_BANDS_HPP_
+#define _MOBIDOT_BANDS_HPP_
+
+#include <Arduino.h>
+#include "gfxfont/gfxfont.h"
+
+/* Band constants */
+#define MOBIDOT_BAND_HEIGHT 5
+#define MOBIDOT_BAND_EMPTY 0x20
+#define MOBIDOT_BAND_MASK 0x1f
+
+/**
+ * @class MobiDOTBands class
+ */
+class MobiDOTBands
+{
+public:
+    /**
+     * MobiDOTBands class constructor
+     * Allocates a buffer for the given size, all pixels are off
+     * @param width Width in pixels
+     * @param height Height in pixels, rounded up to a multiple of MOBIDOT_BAND_HEIGHT
+     */
+    MobiDOTBands(uint width, uint height);
+
+    /**
+     * MobiDOTBands class deconstructor
+     */
+    ~MobiDOTBands();
+
+    MobiDOTBands(const MobiDOTBands &) = delete;
+    MobiDOTBands &operator=(const MobiDOTBands &) = delete;
+
+    uint getWidth() const;
+    uint getHeight() const;
+    uint getBands() const;
+
+    /**
+     * getBand function
+     * @param band Band index, 0 is the top band
+     * @returns Pointer to the first column byte of the band, columns follow each other
+     */
+    uint8_t *getBand(uint band);
+    const uint8_t *getBand(uint band) const;
+
+    /**
+     * clear function
+     * Sets all pixels
+     * @param value True for on, false for off
+     */
+    void clear(bool value = false);
+
+    /**
+     * setPixel function
+     * Sets a single pixel, pixels outside the buffer are ignored
+     * @param x Horizontal position
+     * @param y Vertical position
+     * @param value True for on, false for off
+     */
+    void setPixel(int x, int y, bool value);
+
+    /**
+     * getPixel function
+     * @param x Horizontal position
+     * @param y Vertical position
+     * @returns Value of the pixel, false if outside the buffer
+     */
+    bool getPixel(int x, int y) const;
+
+    /**
+     * setRow function
+     * Packs one row of a bitmap encoded using image2cpp (MSB first, padded to full bytes) into the bands
+     * @param data Row data
+     * @param width Width of the row in pixels
+     * @param x Horizontal offset
+     * @param y Row to write to
+     * @param invert Inverts the row data if true
+     */
+    void setRow(const unsigned char data[], uint width, int x, int y, bool invert = false);
+
+    /**
+     * drawBitmap function
+     * Packs a bitmap encoded using image2cpp into the bands
+     * @param data Bitmap data
+     * @param width Width of the image
+     * @param height Height of the image
+     * @param x Horizontal offset
+     * @param y Vertical offset
+     * @param invert Inverts image data if true
+     */
+    void drawBitmap(const unsigned char data[], uint width, uint height, int x, int y, bool invert = false);
+
+    /**
+     * print function
+     * Rasterizes a string using a GFXfont into the bands, the top of the highest glyph is placed at y
+     * @param c[] String to print
+     * @param font GFXfont to use
+     * @param x Horizontal offset
+     * @param y Vertical offset
+     * @param invert Draw the text as off pixels
+     * @returns Width of the printed string in pixels
+     */
+    uint print(const char c[], const GFXfont *font, int x, int y, bool invert = false);
+
+    /**
+     * textWidth function
+     * @param c[] String to measure
+     * @param font GFXfont to use
+     * @returns Width of the string in pixels when printed using print()
+     */
+    static uint textWidth(const char c[], const GFXfont *font);
+
+private:
+    uint WIDTH;
+    uint HEIGHT;
+    uint BANDS;
+
+    // Band after band, every band holds WIDTH column bytes
+    uint8_t *DATA;
+};
+
+#endif // _MOBIDOT_BANDS_HPP_
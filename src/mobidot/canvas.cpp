@@ -0,0 +1,321 @@
+/**
+ * @file canvas.cpp
+ * Word packed canvas with a blitter for the MobiDOT display library
+ *
+ * Copyright (c) 2021 Arne van Iterson
+ */
+
+#include "./canvas.hpp"
+#include "./bands.hpp"
+
+/**
+ * Clips an area of a source to the source and the destination
+ * @returns False if nothing is left
+ */
+static bool clipArea(int &srcX, int &srcY, int &width, int &height, int &x, int &y, int srcWidth, int srcHeight, int dstWidth, int dstHeight)
+{
+    if (srcX < 0)
+    {
+        width += srcX;
+        x -= srcX;
+        srcX = 0;
+    }
+    if (srcY < 0)
+    {
+        height += srcY;
+        y -= srcY;
+        srcY = 0;
+    }
+    if (x < 0)
+    {
+        width += x;
+        srcX -= x;
+        x = 0;
+    }
+    if (y < 0)
+    {
+        height += y;
+        srcY -= y;
+        y = 0;
+    }
+
+    width = min(width, min(srcWidth - srcX, dstWidth - x));
+    height = min(height, min(srcHeight - srcY, dstHeight - y));
+    return width > 0 && height > 0;
+}
+
+MobiDOTCanvas::MobiDOTCanvas(uint width, uint height)
+{
+    this->WIDTH = width;
+    this->HEIGHT = height;
+    this->STRIDE = (width + 31) / 32;
+
+    this->DATA = new uint32_t[this->STRIDE * this->HEIGHT];
+    this->clear();
+}
+
+MobiDOTCanvas::~MobiDOTCanvas()
+{
+    delete[] this->DATA;
+}
+
+uint MobiDOTCanvas::getWidth() const
+{
+    return this->WIDTH;
+}
+
+uint MobiDOTCanvas::getHeight() const
+{
+    return this->HEIGHT;
+}
+
+uint32_t *MobiDOTCanvas::getRow(uint y)
+{
+    return this->DATA + y * this->STRIDE;
+}
+
+const uint32_t *MobiDOTCanvas::getRow(uint y) const
+{
+    return this->DATA + y * this->STRIDE;
+}
+
+void MobiDOTCanvas::clear(bool value)
+{
+    if (value)
+    {
+        this->fillRect(this->WIDTH, this->HEIGHT, 0, 0, true);
+    }
+    else
+    {
+        memset(this->DATA, 0, this->STRIDE * this->HEIGHT * sizeof(uint32_t));
+    }
+}
+
+void MobiDOTCanvas::setPixel(int x, int y, bool value)
+{
+    if (x < 0 || y < 0 || x >= (int)this->WIDTH || y >= (int)this->HEIGHT)
+    {
+        return;
+    }
+
+    uint32_t *word = this->getRow(y) + (x >> 5);
+    const uint32_t bit = 0x80000000 >> (x & 0x1f);
+
+    if (value)
+    {
+        *word |= bit;
+    }
+    else
+    {
+        *word &= ~bit;
+    }
+}
+
+bool MobiDOTCanvas::getPixel(int x, int y) const
+{
+    if (x < 0 || y < 0 || x >= (int)this->WIDTH || y >= (int)this->HEIGHT)
+    {
+        return false;
+    }
+
+    return this->getRow(y)[x >> 5] >> (31 - (x & 0x1f)) & 0x01;
+}
+
+void MobiDOTCanvas::fillRect(uint width, uint height, int x, int y, bool value, MobiDOTCanvas::Operation op)
+{
+    int srcX = 0;
+    int srcY = 0;
+    int w = width;
+    int h = height;
+    if (!clipArea(srcX, srcY, w, h, x, y, width, height, this->WIDTH, this->HEIGHT))
+    {
+        return;
+    }
+
+    Source source;
+    source.solid = (value) ? 0xffffffff : 0;
+
+    for (int row = 0; row < h; row++)
+    {
+        this->blitRow(y + row, x, w, source, 0, op, nullptr);
+    }
+}
+
+void MobiDOTCanvas::blit(const MobiDOTCanvas &source, int x, int y, MobiDOTCanvas::Operation op)
+{
+    this->blit(source, 0, 0, source.WIDTH, source.HEIGHT, x, y, op);
+}
+
+void MobiDOTCanvas::blit(const MobiDOTCanvas &source, int srcX, int srcY, uint width, uint height, int x, int y,
+                         MobiDOTCanvas::Operation op, const MobiDOTCanvas *mask)
+{
+    int w = width;
+    int h = height;
+    if (!clipArea(srcX, srcY, w, h, x, y, source.WIDTH, source.HEIGHT, this->WIDTH, this->HEIGHT))
+    {
+        return;
+    }
+
+    Source row;
+    row.size = source.STRIDE;
+    Source maskRow;
+    maskRow.size = source.STRIDE;
+
+    for (int i = 0; i < h; i++)
+    {
+        row.words = source.getRow(srcY + i);
+        if (mask != nullptr)
+        {
+            maskRow.words = mask->getRow(srcY + i);
+        }
+        this->blitRow(y + i, x, w, row, srcX, op, (mask) ? &maskRow : nullptr);
+    }
+}
+
+void MobiDOTCanvas::drawBitmap(const unsigned char data[], uint width, uint height, int x, int y,
+                               MobiDOTCanvas::Operation op, const unsigned char mask[])
+{
+    const uint bytesOverWidth = (width + 7) / 8;
+
+    int srcX = 0;
+    int srcY = 0;
+    int w = width;
+    int h = height;
+    if (!clipArea(srcX, srcY, w, h, x, y, width, height, this->WIDTH, this->HEIGHT))
+    {
+        return;
+    }
+
+    Source row;
+    row.size = bytesOverWidth;
+    Source maskRow;
+    maskRow.size = bytesOverWidth;
+
+    for (int i = 0; i < h; i++)
+    {
+        row.bytes = data + (srcY + i) * bytesOverWidth;
+        if (mask != nullptr)
+        {
+            maskRow.bytes = mask + (srcY + i) * bytesOverWidth;
+        }
+        this->blitRow(y + i, x, w, row, srcX, op, (mask) ? &maskRow : nullptr);
+    }
+}
+
+void MobiDOTCanvas::pack(MobiDOTBands &bands) const
+{
+    const uint width = min(this->WIDTH, bands.getWidth());
+    const uint height = min(this->HEIGHT, bands.getHeight());
+
+    for (uint band = 0; band * MOBIDOT_BAND_HEIGHT < height; band++)
+    {
+        uint8_t *columns = bands.getBand(band);
+        const uint top = band * MOBIDOT_BAND_HEIGHT;
+
+        for (uint i = 0; i < this->STRIDE && i * 32 < width; i++)
+        {
+            // Transpose 5 rows of 32 pixels into 32 column bytes, rows below the canvas stay off
+            uint32_t rows[MOBIDOT_BAND_HEIGHT] = {0};
+            for (uint k = 0; k < MOBIDOT_BAND_HEIGHT && top + k < height; k++)
+            {
+                rows[k] = this->getRow(top + k)[i];
+            }
+
+            const uint end = min(width, (i + 1) * 32);
+            for (uint x = i * 32; x < end; x++)
+            {
+                uint8_t value = MOBIDOT_BAND_EMPTY;
+                for (uint k = 0; k < MOBIDOT_BAND_HEIGHT; k++)
+                {
+                    value |= (rows[k] >> 31) << k;
+                    rows[k] <<= 1;
+                }
+                columns[x] = value;
+            }
+        }
+    }
+}
+
+uint32_t MobiDOTCanvas::Source::fetch(int bit) const
+{
+    if (this->words != nullptr)
+    {
+        // Floor division, bits before the row are negative
+        const int index = (bit < 0) ? -1 - ((-1 - bit) >> 5) : bit >> 5;
+        const uint shift = bit & 0x1f;
+
+        const uint32_t high = (index >= 0 && index < (int)this->size) ? this->words[index] : 0;
+        if (shift == 0)
+        {
+            return high;
+        }
+
+        const uint32_t low = (index + 1 >= 0 && index + 1 < (int)this->size) ? this->words[index + 1] : 0;
+        return high << shift | low >> (32 - shift);
+    }
+
+    if (this->bytes != nullptr)
+    {
+        // 32 bits at any offset span at most 5 bytes
+        const int index = (bit < 0) ? -1 - ((-1 - bit) >> 3) : bit >> 3;
+        const uint shift = bit & 0x07;
+
+        uint64_t value = 0;
+        for (int i = index; i < index + 5; i++)
+        {
+            value = value << 8 | ((i >= 0 && i < (int)this->size) ? this->bytes[i] : 0);
+        }
+        return value >> (8 - shift);
+    }
+
+    return this->solid;
+}
+
+void MobiDOTCanvas::blitRow(uint y, int x, uint width, const Source &source, int srcX, MobiDOTCanvas::Operation op, const Source *mask)
+{
+    uint32_t *row = this->getRow(y);
+    const uint first = x >> 5;
+    const uint last = (x + width - 1) >> 5;
+
+    for (uint i = first; i <= last; i++)
+    {
+        // Only touch the pixels of the area in the first and last word
+        uint32_t edge = 0xffffffff;
+        if (i == first)
+        {
+            edge &= 0xffffffff >> (x & 0x1f);
+        }
+        if (i == last)
+        {
+            edge &= 0xffffffff << (31 - ((x + width - 1) & 0x1f));
+        }
+
+        // Source pixel that lands on the first pixel of this word
+        const int bit = srcX + (int)(i * 32) - x;
+        const uint32_t s = source.fetch(bit);
+        const uint32_t d = row[i];
+
+        uint32_t value;
+        switch (op)
+        {
+        case OR:
+            value = d | s;
+            break;
+        case AND:
+            value = d & s;
+            break;
+        case XOR:
+            value = d ^ s;
+            break;
+        case MASK:
+            edge &= (mask) ? mask->fetch(bit) : s;
+            value = s;
+            break;
+        default:
+            value = s;
+            break;
+        }
+
+        row[i] = (d & ~edge) | (value & edge);
+    }
+}
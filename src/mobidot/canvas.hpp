@@ -0,0 +1,175 @@
+/**
+ * @file canvas.hpp
+ * Word packed canvas with a blitter for the MobiDOT display library
+ *
+ * Layers like backgrounds, icons, cursors and text are composed on a canvas in RAM and packed into the band layout
+ * of the display once per frame, see MobiDOT::drawCanvas(). Pixels are stored row after row in 32 bit words,
+ * most significant bit first like bitmaps made using image2cpp, so the blitter shifts and combines 32 pixels at a time
+ * at any bit offset instead of going pixel by pixel.
+ *
+ * Copyright (c) 2021 Arne van Iterson
+ */
+
+#ifndef _MOBIDOT_CANVAS_HPP_
+#define _MOBIDOT_CANVAS_HPP_
+
+#include <Arduino.h>
+
+class MobiDOTBands;
+
+/**
+ * @class MobiDOTCanvas class
+ */
+class MobiDOTCanvas
+{
+public:
+    /**
+     * @enum Operation
+     * Raster operations of the blitter, combining source pixels (s) with the pixels on the canvas (d)
+     */
+    enum Operation
+    {
+        COPY, // s
+        OR,   // d | s
+        AND,  // d & s
+        XOR,  // d ^ s
+        MASK  // s where the mask is set, d elsewhere. Without a mask the source is its own mask, so off pixels are transparent
+    };
+
+    /**
+     * MobiDOTCanvas class constructor
+     * Allocates a canvas for the given size, all pixels are off
+     * @param width Width in pixels
+     * @param height Height in pixels
+     */
+    MobiDOTCanvas(uint width, uint height);
+
+    /**
+     * MobiDOTCanvas class deconstructor
+     */
+    ~MobiDOTCanvas();
+
+    MobiDOTCanvas(const MobiDOTCanvas &) = delete;
+    MobiDOTCanvas &operator=(const MobiDOTCanvas &) = delete;
+
+    uint getWidth() const;
+    uint getHeight() const;
+
+    /**
+     * getRow function
+     * @param y Row index, 0 is the top row
+     * @returns Pointer to the first word of the row, pixel x is bit 31 - x % 32 of word x / 32
+     */
+    uint32_t *getRow(uint y);
+    const uint32_t *getRow(uint y) const;
+
+    /**
+     * clear function
+     * Sets all pixels
+     * @param value True for on, false for off
+     */
+    void clear(bool value = false);
+
+    /**
+     * setPixel function
+     * Sets a single pixel, pixels outside the canvas are ignored
+     * @param x Horizontal position
+     * @param y Vertical position
+     * @param value True for on, false for off
+     */
+    void setPixel(int x, int y, bool value);
+
+    /**
+     * getPixel function
+     * @param x Horizontal position
+     * @param y Vertical position
+     * @returns Value of the pixel, false if outside the canvas
+     */
+    bool getPixel(int x, int y) const;
+
+    /**
+     * fillRect function
+     * Applies a raster operation with a solid source to an area, e.g. XOR with true inverts the area
+     * @param width Width of the area
+     * @param height Height of the area
+     * @param x Horizontal offset
+     * @param y Vertical offset
+     * @param value Value of the source pixels
+     * @param op Raster operation (optional, COPY if not specified)
+     */
+    void fillRect(uint width, uint height, int x, int y, bool value = true, MobiDOTCanvas::Operation op = COPY);
+
+    /**
+     * blit function
+     * Combines another canvas, or an area of it, with this canvas. Areas outside of either canvas are clipped
+     * @param source Canvas to read from, must not be this canvas
+     * @param srcX Horizontal offset of the area in the source (optional, entire source if not specified)
+     * @param srcY Vertical offset of the area in the source (see srcX)
+     * @param width Width of the area (see srcX)
+     * @param height Height of the area (see srcX)
+     * @param x Horizontal offset on this canvas
+     * @param y Vertical offset on this canvas
+     * @param op Raster operation (optional, COPY if not specified)
+     * @param mask Canvas with the same size as the source, only used by MASK (optional)
+     */
+    void blit(const MobiDOTCanvas &source, int x, int y, MobiDOTCanvas::Operation op = COPY);
+    void blit(const MobiDOTCanvas &source, int srcX, int srcY, uint width, uint height, int x, int y,
+              MobiDOTCanvas::Operation op = COPY, const MobiDOTCanvas *mask = nullptr);
+
+    /**
+     * drawBitmap function
+     * Combines a bitmap encoded using image2cpp with this canvas, areas outside of the canvas are clipped
+     * @param data Bitmap data
+     * @param width Width of the image
+     * @param height Height of the image
+     * @param x Horizontal offset
+     * @param y Vertical offset
+     * @param op Raster operation (optional, COPY if not specified)
+     * @param mask Bitmap with the same size and encoding as data, only used by MASK (optional)
+     */
+    void drawBitmap(const unsigned char data[], uint width, uint height, int x, int y,
+                    MobiDOTCanvas::Operation op = COPY, const unsigned char mask[] = nullptr);
+
+    /**
+     * pack function
+     * Converts the canvas into the band layout of the display, 32 columns at a time.
+     * Pixels outside of the bands are clipped, bands outside of the canvas are not changed
+     * @param bands Band packed buffer to write to
+     */
+    void pack(MobiDOTBands &bands) const;
+
+private:
+    uint WIDTH;
+    uint HEIGHT;
+    uint STRIDE; // Words per row
+
+    // Row after row, every row holds STRIDE words, bits past WIDTH are kept off
+    uint32_t *DATA;
+
+    /**
+     * @struct Source
+     * Row of source pixels, either words of a canvas, bytes of a bitmap or a solid value if neither is set
+     */
+    struct Source
+    {
+        const uint32_t *words = nullptr;
+        const uint8_t *bytes = nullptr;
+        uint size = 0; // In words or bytes
+        uint32_t solid = 0;
+
+        /**
+         * fetch function
+         * @param bit Index of the first pixel, pixels outside of the row read as off
+         * @returns 32 pixels starting at bit, first pixel in the most significant bit
+         */
+        uint32_t fetch(int bit) const;
+    };
+
+    /**
+     * blitRow function
+     * Combines one row of source pixels with a row of the canvas, the area has to be clipped already
+     */
+    void blitRow(uint y, int x, uint width, const Source &source, int srcX, MobiDOTCanvas::Operation op, const Source *mask);
+};
+
+#endif // _MOBIDOT_CANVAS_HPP_
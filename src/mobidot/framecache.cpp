@@ -0,0 +1,206 @@
+/**
+ * @file framecache.cpp
+ * Cache of encoded frames for the MobiDOT display library
+ *
+ * Copyright (c) 2021 Arne van Iterson
+ */
+
+#include "./framecache.hpp"
+#include "./trace.hpp"
+
+MobiDOTFrameCache::MobiDOTFrameCache(MobiDOT &mobidot, MobiDOTFrameSpill *spill)
+{
+    this->MOBIDOT = &mobidot;
+    this->SPILL = spill;
+}
+
+MobiDOTFrameCache::~MobiDOTFrameCache()
+{
+    this->clear();
+}
+
+bool MobiDOTFrameCache::drawBitmap(MobiDOT::Display type, const unsigned char data[], uint width, uint height,
+                                   bool invert, MobiDOT::Priority priority)
+{
+    MOBIDOT_TRACE_SCOPE("cacheBitmap");
+    MobiDOT *mobidot = this->MOBIDOT;
+    mobidot->selectDisplay(type);
+
+    // Whatever is in the buffer would end up in the cached frame and be sent again on every hit
+    if (mobidot->hasWidgets(type) || !mobidot->isBufferEmpty())
+    {
+        mobidot->drawBitmap(data, width, height, invert);
+        return mobidot->update(priority);
+    }
+
+    uint64_t value = this->key(type, (invert) ? 'I' : 'B', width, height);
+    value = this->hash(value, data, height * ((width + 7) / 8));
+
+    bool hit;
+    const bool result = this->lookup(value, priority, hit);
+    if (hit)
+    {
+        return result;
+    }
+
+    mobidot->drawBitmap(data, width, height, invert);
+    return this->insert(value, priority);
+}
+
+bool MobiDOTFrameCache::drawCanvas(MobiDOT::Display type, const MobiDOTCanvas &canvas, MobiDOT::Priority priority)
+{
+    MOBIDOT_TRACE_SCOPE("cacheCanvas");
+    MobiDOT *mobidot = this->MOBIDOT;
+    mobidot->selectDisplay(type);
+
+    if (mobidot->hasWidgets(type) || !mobidot->isBufferEmpty())
+    {
+        mobidot->drawCanvas(canvas);
+        return mobidot->update(priority);
+    }
+
+    // Padding bits of a canvas are always off, so whole rows can be hashed
+    const uint stride = (canvas.getWidth() + 31) / 32;
+    uint64_t value = this->key(type, 'C', canvas.getWidth(), canvas.getHeight());
+    for (uint y = 0; y < canvas.getHeight(); y++)
+    {
+        value = this->hash(value, canvas.getRow(y), stride * sizeof(uint32_t));
+    }
+
+    bool hit;
+    const bool result = this->lookup(value, priority, hit);
+    if (hit)
+    {
+        return result;
+    }
+
+    mobidot->drawCanvas(canvas);
+    return this->insert(value, priority);
+}
+
+void MobiDOTFrameCache::clear()
+{
+    for (Entry &entry : this->ENTRIES)
+    {
+        delete[] entry.data;
+        entry = Entry();
+    }
+}
+
+uint32_t MobiDOTFrameCache::getHits()
+{
+    return this->HITS;
+}
+
+uint32_t MobiDOTFrameCache::getSpillHits()
+{
+    return this->SPILL_HITS;
+}
+
+uint32_t MobiDOTFrameCache::getMisses()
+{
+    return this->MISSES;
+}
+
+uint64_t MobiDOTFrameCache::hash(uint64_t value, const void *data, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        value = (value ^ bytes[i]) * 1099511628211ull;
+    }
+    return value;
+}
+
+uint64_t MobiDOTFrameCache::key(MobiDOT::Display type, char kind, uint width, uint height)
+{
+    const uint8_t header[] = {(uint8_t)type, (uint8_t)kind,
+                              (uint8_t)(width >> 8), (uint8_t)width, (uint8_t)(height >> 8), (uint8_t)height};
+    return hash(14695981039346656037ull, header, sizeof(header));
+}
+
+bool MobiDOTFrameCache::lookup(uint64_t key, MobiDOT::Priority priority, bool &hit)
+{
+    hit = false;
+
+    for (Entry &entry : this->ENTRIES)
+    {
+        if (entry.data != nullptr && entry.key == key)
+        {
+            hit = true;
+            this->HITS++;
+            entry.used = ++this->TICK;
+            return this->MOBIDOT->send(entry.data, entry.size, priority);
+        }
+    }
+
+    if (this->SPILL == nullptr)
+    {
+        return false;
+    }
+
+    uint size = 0;
+    char *data = this->SPILL->load(key, size);
+    if (data == nullptr)
+    {
+        return false;
+    }
+
+    // Keep it in RAM again, it does not have to be spilled a second time
+    hit = true;
+    this->SPILL_HITS++;
+
+    Entry &entry = this->evict();
+    entry.key = key;
+    entry.data = data;
+    entry.size = size;
+    entry.used = ++this->TICK;
+    entry.spilled = true;
+    return this->MOBIDOT->send(data, size, priority);
+}
+
+bool MobiDOTFrameCache::insert(uint64_t key, MobiDOT::Priority priority)
+{
+    this->MISSES++;
+
+    char *data;
+    const uint size = this->MOBIDOT->encode(data);
+    if (data == nullptr)
+    {
+        return false;
+    }
+
+    Entry &entry = this->evict();
+    entry.key = key;
+    entry.data = data;
+    entry.size = size;
+    entry.used = ++this->TICK;
+    entry.spilled = false;
+    return this->MOBIDOT->send(data, size, priority);
+}
+
+MobiDOTFrameCache::Entry &MobiDOTFrameCache::evict()
+{
+    Entry *oldest = &this->ENTRIES[0];
+    for (Entry &entry : this->ENTRIES)
+    {
+        if (entry.data == nullptr)
+        {
+            return entry;
+        }
+        if ((int32_t)(entry.used - oldest->used) < 0)
+        {
+            oldest = &entry;
+        }
+    }
+
+    MOBIDOT_TRACE_SCOPE("cacheEvict");
+    if (this->SPILL != nullptr && !oldest->spilled)
+    {
+        this->SPILL->store(oldest->key, oldest->data, oldest->size);
+    }
+
+    delete[] oldest->data;
+    *oldest = Entry();
+    return *oldest;
+}
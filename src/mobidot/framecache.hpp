@@ -0,0 +1,183 @@
+/**
+ * @file framecache.hpp
+ * Cache of encoded frames for the MobiDOT display library
+ *
+ * Signs show the same route numbers, destinations and icons over and over. Full frames drawn through the cache are
+ * looked up by a hash of their content and target display, a hit queues the frame as it was sent before so drawing,
+ * encoding and adding the footer are skipped. The least recently used frames are kept in RAM, frames that are evicted
+ * can be spilled to a MobiDOTFrameSpill, e.g. on LittleFS, and are loaded back from there on a miss.
+ *
+ * Usage:
+ *   MobiDOTFrameCache cache(MobiDOT);
+ *   cache.drawBitmap(MobiDOT::Display::REAR, bitmap, 21, 14, true); // Instead of drawBitmap() and update()
+ *
+ * Copyright (c) 2021 Arne van Iterson
+ */
+
+#ifndef _MOBIDOT_FRAMECACHE_HPP_
+#define _MOBIDOT_FRAMECACHE_HPP_
+
+#include <Arduino.h>
+#include "./mobidot.hpp"
+#include "./canvas.hpp"
+
+/* Amount of frames kept in RAM */
+#ifndef MOBIDOT_FRAMECACHE_SIZE
+#define MOBIDOT_FRAMECACHE_SIZE 8
+#endif
+
+/**
+ * @class MobiDOTFrameSpill class
+ * Second level of the cache for frames evicted from RAM, implemented by the application
+ */
+class MobiDOTFrameSpill
+{
+public:
+    /**
+     * load function
+     * @param key Hash of the frame content
+     * @param size Set to the size of the frame
+     * @returns New buffer holding the frame, the cache deletes it. nullptr if the frame is not stored
+     */
+    virtual char *load(uint64_t key, uint &size) = 0;
+
+    /**
+     * store function
+     * Stores a frame that is evicted from RAM, may replace other stored frames
+     * @param key Hash of the frame content
+     * @param data Frame data, including header and footer
+     * @param size Size of the frame data
+     */
+    virtual void store(uint64_t key, const char data[], uint size) = 0;
+};
+
+/**
+ * @class MobiDOTFrameCache class
+ */
+class MobiDOTFrameCache
+{
+public:
+    /**
+     * MobiDOTFrameCache class constructor
+     * @param mobidot Display controller to draw and send the frames with
+     * @param spill Storage for frames evicted from RAM (optional, frames are dropped if not specified)
+     */
+    MobiDOTFrameCache(MobiDOT &mobidot, MobiDOTFrameSpill *spill = nullptr);
+
+    /**
+     * MobiDOTFrameCache class deconstructor
+     */
+    ~MobiDOTFrameCache();
+
+    MobiDOTFrameCache(const MobiDOTFrameCache &) = delete;
+    MobiDOTFrameCache &operator=(const MobiDOTFrameCache &) = delete;
+
+    /**
+     * drawBitmap function
+     * Sends a bitmap as a full frame, like selectDisplay(), drawBitmap() and update() do.
+     * Displays with widgets are not cached, their frames depend on the widgets as well. Neither is anything drawn while
+     * the buffer holds an unsent frame, that frame is sent along
+     * @param type MobiDOT::Display type
+     * @param data Bitmap, see MobiDOT::drawBitmap()
+     * @param width Width of the bitmap
+     * @param height Height of the bitmap
+     * @param invert Invert the bitmap
+     * @param priority Priority of the frame (optional, NORMAL if not specified)
+     * @returns True if the frame was queued
+     */
+    bool drawBitmap(MobiDOT::Display type, const unsigned char data[], uint width, uint height, bool invert,
+                    MobiDOT::Priority priority = MobiDOT::Priority::NORMAL);
+
+    /**
+     * drawCanvas function
+     * Sends a canvas as a full frame, like selectDisplay(), drawCanvas() and update() do.
+     * Displays with widgets are not cached, their frames depend on the widgets as well. Neither is anything drawn while
+     * the buffer holds an unsent frame, that frame is sent along
+     * @param type MobiDOT::Display type
+     * @param canvas Canvas with the content of the display
+     * @param priority Priority of the frame (optional, NORMAL if not specified)
+     * @returns True if the frame was queued
+     */
+    bool drawCanvas(MobiDOT::Display type, const MobiDOTCanvas &canvas,
+                    MobiDOT::Priority priority = MobiDOT::Priority::NORMAL);
+
+    /**
+     * clear function
+     * Drops every frame kept in RAM, e.g. after changing a font. The spill storage is not cleared
+     */
+    void clear();
+
+    /**
+     * getHits, getSpillHits and getMisses functions
+     * Counters to tune MOBIDOT_FRAMECACHE_SIZE with: frames found in RAM, frames loaded from the spill storage and
+     * frames that had to be encoded
+     */
+    uint32_t getHits();
+    uint32_t getSpillHits();
+    uint32_t getMisses();
+
+private:
+    MobiDOT *MOBIDOT;
+    MobiDOTFrameSpill *SPILL;
+
+    /**
+     * @struct Entry
+     * Frame kept in RAM
+     */
+    struct Entry
+    {
+        uint64_t key = 0;
+        char *data = nullptr; // nullptr if the entry is free
+        uint size = 0;
+        uint32_t used = 0;    // Value of TICK when the entry was last used
+        bool spilled = false; // Stored in the spill storage already
+    };
+
+    Entry ENTRIES[MOBIDOT_FRAMECACHE_SIZE];
+    uint32_t TICK = 0;
+
+    uint32_t HITS = 0;
+    uint32_t SPILL_HITS = 0;
+    uint32_t MISSES = 0;
+
+    /**
+     * hash function
+     * 64 bit FNV-1a hash, continues from the given hash so content can be hashed in parts
+     * @param value Hash so far
+     * @param data Data to add
+     * @param size Size of the data
+     * @returns Hash including the data
+     */
+    static uint64_t hash(uint64_t value, const void *data, size_t size);
+
+    /**
+     * key function
+     * Starts the hash of a frame with what is not part of its content
+     * @returns Hash of the display, the kind of frame and its size
+     */
+    static uint64_t key(MobiDOT::Display type, char kind, uint width, uint height);
+
+    /**
+     * lookup function
+     * Sends a frame from RAM or the spill storage
+     * @param hit Set to true if the frame was found
+     * @returns True if the frame was queued
+     */
+    bool lookup(uint64_t key, MobiDOT::Priority priority, bool &hit);
+
+    /**
+     * insert function
+     * Encodes what was drawn in the buffer, keeps it in RAM and sends it
+     * @returns True if the frame was queued
+     */
+    bool insert(uint64_t key, MobiDOT::Priority priority);
+
+    /**
+     * evict function
+     * Frees the least recently used entry, spilling its frame first
+     * @returns Entry that is free now
+     */
+    Entry &evict();
+};
+
+#endif // _MOBIDOT_FRAMECACHE_HPP_
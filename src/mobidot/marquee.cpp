@@ -0,0 +1,102 @@
+/**
+ * @file marquee.cpp
+ * Scrolling text for the MobiDOT display library
+ *
+ * Copyright (c) 2021 Arne van Iterson
+ */
+
+#include "./marquee.hpp"
+
+MobiDOTMarquee::MobiDOTMarquee(MobiDOT &mobidot, MobiDOT::Display type, const char text[], const GFXfont *font, int x, int y, uint width, uint interval)
+{
+    this->MOBIDOT = &mobidot;
+    this->TYPE = type;
+    this->X = x;
+    this->Y = y;
+    this->INTERVAL = interval;
+
+    // A window that starts beyond the edge of the display is empty, nothing will be sent. A wider window is cut off
+    // at the edge, the columns past it would be drawn off the display
+    const int displayWidth = mobidot.getWidth(type);
+    const int displayHeight = mobidot.getHeight(type);
+    const uint available = (x >= displayWidth) ? 0 : displayWidth - x;
+    this->WIDTH = (width) ? min(width, available) : available;
+    const uint height = (y >= displayHeight) ? 0 : displayHeight - y;
+
+    // Rasterize once: empty window, text, empty window
+    const uint textWidth = MobiDOTBands::textWidth(text, font);
+    this->STRIP = new MobiDOTBands(this->WIDTH + textWidth + this->WIDTH, height);
+    this->STRIP->print(text, font, this->WIDTH, 0);
+}
+
+MobiDOTMarquee::~MobiDOTMarquee()
+{
+    delete this->STRIP;
+}
+
+bool MobiDOTMarquee::loop()
+{
+    // Steps are only sent on an idle bus, every step depends on the previous one being shown
+    if (this->MOBIDOT->isBusy() || this->WIDTH == 0 || this->STRIP->getBands() == 0)
+    {
+        return false;
+    }
+
+    if (this->OFFSET >= 0 && millis() - this->LAST_STEP < this->getInterval())
+    {
+        return false;
+    }
+    this->LAST_STEP = millis();
+
+    MobiDOT *mobidot = this->MOBIDOT;
+
+    // Steps are encoded on their own, a frame being drawn for another display is left alone
+    if (this->OFFSET < 0)
+    {
+        // Nothing is known about the display, send the entire window
+        if (!mobidot->sendBands(this->TYPE, *this->STRIP, 0, this->WIDTH, this->X, this->Y))
+        {
+            return false;
+        }
+        this->OFFSET = 0;
+        return true;
+    }
+
+    const int previous = this->OFFSET;
+    const int next = (this->OFFSET + 1) % (this->STRIP->getWidth() - this->WIDTH + 1);
+
+    // Wrapping around and blank stretches of the text change nothing, sending just a header would waste bus time
+    bool changed = false;
+    for (uint i = 0; i < this->STRIP->getBands() && !changed; i++)
+    {
+        const uint8_t *band = this->STRIP->getBand(i);
+        changed = memcmp(band + next, band + previous, this->WIDTH) != 0;
+    }
+    if (!changed)
+    {
+        this->OFFSET = next;
+        return false;
+    }
+
+    // Only columns that differ from the previous step are sent, the step is tried again if it was not queued
+    if (!mobidot->sendBandsChanged(this->TYPE, *this->STRIP, next, *this->STRIP, previous, this->WIDTH, this->X, this->Y))
+    {
+        return false;
+    }
+    this->OFFSET = next;
+    return true;
+}
+
+void MobiDOTMarquee::reset()
+{
+    this->OFFSET = -1;
+}
+
+uint MobiDOTMarquee::getInterval()
+{
+    // Worst case step: every column of the window changed
+    const uint frameSize = MOBIDOT_FRAME_OVERHEAD + this->STRIP->getBands() * (MOBIDOT_SEGMENT_HEADER + this->WIDTH);
+    const uint busTime = frameSize * 1000 / max(this->MOBIDOT->getThroughput(), (uint32_t)1);
+
+    return max(this->INTERVAL, busTime);
+}
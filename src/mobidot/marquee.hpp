@@ -0,0 +1,80 @@
+/**
+ * @file marquee.hpp
+ * Scrolling text for the MobiDOT display library
+ *
+ * The text is rasterized once into a band packed strip, every step only sends the columns of the window
+ * that changed compared to the previous step. Steps are paced to the measured speed of the bus.
+ *
+ * Copyright (c) 2021 Arne van Iterson
+ */
+
+#ifndef _MOBIDOT_MARQUEE_HPP_
+#define _MOBIDOT_MARQUEE_HPP_
+
+#include "./mobidot.hpp"
+#include "./bands.hpp"
+
+/**
+ * @class MobiDOTMarquee class
+ */
+class MobiDOTMarquee
+{
+public:
+    /**
+     * MobiDOTMarquee class constructor
+     * Rasterizes the text, nothing is sent until loop() is called
+     * @param mobidot Display controller to send the steps with
+     * @param type Display to scroll on
+     * @param text String to scroll
+     * @param font GFXfont to use, fonts built into the display can not be rasterized
+     * @param x Horizontal offset of the window, nothing is sent if it is beyond the display
+     * @param y Vertical offset of the window, nothing is sent if it is beyond the display
+     * @param width Width of the window, at most the rest of the display (optional, rest of the display if 0)
+     * @param interval Minimum time between steps in milliseconds (optional, as fast as the bus allows if 0)
+     */
+    MobiDOTMarquee(MobiDOT &mobidot, MobiDOT::Display type, const char text[], const GFXfont *font, int x = 0, int y = 0, uint width = 0, uint interval = 0);
+
+    /**
+     * MobiDOTMarquee class deconstructor
+     */
+    ~MobiDOTMarquee();
+
+    /**
+     * loop function
+     * Queues the next step if it is due and the bus is idle, call this from loop() after MobiDOT::loop().
+     * Steps are encoded on their own, the display buffer and selected display of the MobiDOT are left untouched and
+     * widgets are not drawn
+     * @returns True if a step was queued, false if it was not due or did not change a single column
+     */
+    bool loop();
+
+    /**
+     * reset function
+     * Starts scrolling from the beginning again, the next step sends the entire window
+     */
+    void reset();
+
+    /**
+     * getInterval function
+     * @returns Time between steps in milliseconds, the largest of the requested interval and the time a full window takes on the bus
+     */
+    uint getInterval();
+
+private:
+    MobiDOT *MOBIDOT;
+    MobiDOT::Display TYPE;
+
+    // Text with an empty window in front and behind it, so the text scrolls in and out and the loop is seamless
+    MobiDOTBands *STRIP;
+
+    int X;
+    int Y;
+    uint WIDTH;
+    uint INTERVAL;
+
+    // First column of the strip currently shown, -1 if nothing has been sent yet
+    int OFFSET = -1;
+    unsigned long LAST_STEP = 0;
+};
+
+#endif // _MOBIDOT_MARQUEE_HPP_
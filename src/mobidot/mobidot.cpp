@@ -8,6 +8,11 @@
  */
 
 #include "./mobidot.hpp"
+#include "./widget.hpp"
+#include "./bands.hpp"
+#include "./bandfont.hpp"
+#include "./canvas.hpp"
+#include "./trace.hpp"
 
 /**
  * MobiDOT class constructors
@@ -30,12 +35,33 @@ MobiDOT::MobiDOT(const uint8_t rx, const uint8_t tx, const uint8_t ctrl, const u
         this->PIN_LIGHT = light;
         pinMode(this->PIN_LIGHT, OUTPUT);
     }
+
+    // Init framebuffers, nothing is known about the displays yet
+    for (uint i = 0; i < MOBIDOT_DISPLAY_COUNT; i++)
+    {
+        this->FRAMEBUFFER[i] = new MobiDOTBands(this->display[i].width, this->display[i].height);
+    }
 }
 
 MobiDOT::~MobiDOT()
 {
     digitalWrite(this->PIN_CTRL, RS485_RX_PIN_VALUE);
     this->RS485.end();
+
+    for (uint i = 0; i < MOBIDOT_DISPLAY_COUNT; i++)
+    {
+        delete this->FRAMEBUFFER[i];
+    }
+
+    // Free queued frames
+    delete[] this->ACTIVE.data;
+    for (uint i = 0; i < MOBIDOT_PRIORITY_COUNT; i++)
+    {
+        for (uint j = 0; j < MOBIDOT_DISPLAY_COUNT; j++)
+        {
+            delete[] this->QUEUE[i][j].data;
+        }
+    }
 }
 
 /**
@@ -47,6 +73,21 @@ void MobiDOT::selectDisplay(MobiDOT::Display type)
     this->DISPLAY_DEFAULT = type;
 }
 
+uint MobiDOT::getWidth(MobiDOT::Display type)
+{
+    return this->display[(uint)type].width;
+}
+
+uint MobiDOT::getHeight(MobiDOT::Display type)
+{
+    return this->display[(uint)type].height;
+}
+
+char MobiDOT::getAddress(MobiDOT::Display type)
+{
+    return this->display[(uint)type].address;
+}
+
 void MobiDOT::setLight(bool state)
 {
     if (this->PIN_LIGHT != -1)
@@ -84,10 +125,7 @@ void MobiDOT::print(const char c[], MobiDOT::Font font)
 void MobiDOT::print(const char c[], MobiDOT::Font font, int offsetX, int offsetY)
 {
     // Check if the current buffer is empty, if so add the MobiDOT header
-    if (this->BUFFER_DATA[0] != 0xff)
-    {
-        this->addHeader(this->DISPLAY_DEFAULT, this->BUFFER_DATA, this->BUFFER_SIZE);
-    }
+    this->beginFrame();
 
     uint *size = &this->BUFFER_SIZE;
 
@@ -253,11 +291,106 @@ void MobiDOT::print(const char c[], const GFXfont *font, int offsetX, int offset
             !invert                                     // Invert
         );
 
+        delete[] charData;
+        delete[] buffer;
+
         // Update cursor for the next char
         cursor = cursor + charXadvance;
     }
 };
 
+void MobiDOT::print(const char c[], const MobiDOTBandFont &font, bool invert)
+{
+    this->print(c, font, 0, 0, invert);
+}
+
+void MobiDOT::print(const char c[], const MobiDOTBandFont &font, int offsetX, int offsetY, bool invert)
+{
+    // Check if the current buffer is empty, if so add the MobiDOT header
+    this->beginFrame();
+
+    uint *size = &this->BUFFER_SIZE;
+    const size_t length = strlen(c);
+
+    // Glyph words hold the index of the first column, where that column is relative to the cursor and the advance
+    auto glyph = [&font](const uint8_t value) -> uint16_t
+    {
+        // Make sure that the selected char is in the scope of the font, otherwise display a space
+        return (value >= font.first && value <= font.last) ? value - font.first : 0x20 - font.first;
+    };
+
+    // Glyphs can reach over the cursor or beyond their advance, find the columns the whole string covers
+    int left = 0;
+    int right = 0;
+    int cursor = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        const uint16_t index = glyph(c[i]);
+        const uint32_t g = pgm_read_dword(&font.glyphs[index]);
+        const int start = cursor + (int8_t)(g >> 8);
+        const int end = start + (pgm_read_dword(&font.glyphs[index + 1]) >> 16) - (g >> 16);
+
+        left = min(left, start);
+        right = max(right, max(end, cursor + (int)(g & 0xff)));
+        cursor += g & 0xff;
+    }
+
+    // Columns left of the display are cut off
+    const int skip = max(-(offsetX + left), 0);
+    if (right - left <= skip)
+    {
+        return;
+    }
+    const uint width = right - left - skip;
+
+    const uint bands = (font.height + MOBIDOT_BAND_HEIGHT - 1) / MOBIDOT_BAND_HEIGHT;
+    if (*size + bands * (MOBIDOT_SEGMENT_HEADER + width) + MOBIDOT_FRAME_OVERHEAD > RS485_BUFFER_SIZE)
+    {
+        return;
+    }
+
+    for (uint band = 0; band < bands; band++)
+    {
+        // Bits of this band that are part of the font cell, the rest stays off when inverting
+        const uint8_t rows = min(font.height - band * MOBIDOT_BAND_HEIGHT, (uint)MOBIDOT_BAND_HEIGHT);
+        const uint8_t mask = (invert) ? (1 << rows) - 1 : 0;
+        const uint8_t shift = band * MOBIDOT_BAND_HEIGHT;
+
+        this->BUFFER_DATA[(*size)++] = 0xd2;
+        this->BUFFER_DATA[(*size)++] = offsetX + left + skip;
+        this->BUFFER_DATA[(*size)++] = 0xd3;
+        this->BUFFER_DATA[(*size)++] = offsetY + 4 + shift;
+        this->BUFFER_DATA[(*size)++] = 0xd4;
+        this->BUFFER_DATA[(*size)++] = (char)MobiDOT::Font::BITWISE;
+
+        // Overlapping columns of neighbouring glyphs are combined
+        char *columns = this->BUFFER_DATA + *size;
+        memset(columns, MOBIDOT_BAND_EMPTY, width);
+
+        cursor = -left - skip;
+        for (size_t i = 0; i < length; i++)
+        {
+            const uint16_t index = glyph(c[i]);
+            const uint32_t g = pgm_read_dword(&font.glyphs[index]);
+            const uint32_t *column = font.columns + (g >> 16);
+            const int start = cursor + (int8_t)(g >> 8);
+            const int count = (pgm_read_dword(&font.glyphs[index + 1]) >> 16) - (g >> 16);
+
+            for (int j = max(-start, 0); j < count; j++)
+            {
+                columns[start + j] |= pgm_read_dword(&column[j]) >> shift & MOBIDOT_BAND_MASK;
+            }
+            cursor += g & 0xff;
+        }
+
+        for (uint j = 0; j < width; j++)
+        {
+            columns[j] ^= mask;
+        }
+        *size += width;
+    }
+}
+
 void MobiDOT::drawRect(uint width, uint height, bool fill)
 {
     this->drawRect(width, height, 0, 0, fill);
@@ -319,6 +452,8 @@ void MobiDOT::drawRect(uint width, uint height, int x, int y, bool fill)
         y,      // Y offset
         true    // Invert
     );
+
+    delete[] buffer;
 }
 
 void MobiDOT::drawLine(int x1, int y1, int x2, int y2)
@@ -375,15 +510,27 @@ void MobiDOT::drawLine(int x1, int y1, int x2, int y2)
         startY,        // Y offset
         true          // Invert
     );
+
+    delete[] buffer;
 }
 
-bool MobiDOT::update()
+bool MobiDOT::update(MobiDOT::Priority priority)
 {
+    MOBIDOT_TRACE_SCOPE("update");
     uint *size = &this->BUFFER_SIZE;
 
-    // Add display footer and send
+    // Draw retained widgets on top of the buffer
+    this->addWidgets(this->DISPLAY_DEFAULT);
+
+    // Nothing was drawn, do not send an empty frame
+    if (*size == 0)
+    {
+        return false;
+    }
+
+    // Add display footer and queue
     this->addFooter(this->BUFFER_DATA, *size);
-    bool result = this->sendBuffer(this->BUFFER_DATA, *size);
+    bool result = this->sendBuffer(this->DISPLAY_DEFAULT, this->BUFFER_DATA, *size, priority);
 
     // Clear current display buffer
     memset(this->BUFFER_DATA, 0, sizeof(this->BUFFER_DATA));
@@ -392,24 +539,242 @@ bool MobiDOT::update()
     return result;
 }
 
-void MobiDOT::clear(bool value)
+uint MobiDOT::encode(char *&data)
 {
-    // Check if the current buffer is empty, if so add the MobiDOT header
-    if (this->BUFFER_DATA[0] != 0xff)
+    MOBIDOT_TRACE_SCOPE("encode");
+    uint *size = &this->BUFFER_SIZE;
+    data = nullptr;
+
+    // Draw retained widgets on top of the buffer
+    this->addWidgets(this->DISPLAY_DEFAULT);
+
+    if (*size == 0)
     {
-        this->addHeader(this->DISPLAY_DEFAULT, this->BUFFER_DATA, this->BUFFER_SIZE);
+        return 0;
     }
 
-    uint *size = &this->BUFFER_SIZE;
+    this->addFooter(this->BUFFER_DATA, *size);
+    data = new char[*size];
+    memcpy(data, this->BUFFER_DATA, *size);
+    const uint result = *size;
+
+    // Clear current display buffer
+    memset(this->BUFFER_DATA, 0, sizeof(this->BUFFER_DATA));
+    *size = 0;
+
+    return result;
+}
+
+uint MobiDOT::encodeFramebuffer(MobiDOT::Display type, char *&data)
+{
+    MOBIDOT_TRACE_SCOPE("encodeFramebuffer");
+    const MobiDOTBands &framebuffer = *this->FRAMEBUFFER[(uint)type];
+    const uint width = framebuffer.getWidth();
+
+    uint size = 0;
+    data = new char[MOBIDOT_FRAME_OVERHEAD + framebuffer.getBands() * (MOBIDOT_SEGMENT_HEADER + width)];
+    this->addHeader(type, data, size);
+
+    for (uint i = 0; i < framebuffer.getBands(); i++)
+    {
+        data[size++] = 0xd2;
+        data[size++] = 0;
+        data[size++] = 0xd3;
+        data[size++] = i * MOBIDOT_BAND_HEIGHT + 4;
+        data[size++] = 0xd4;
+        data[size++] = (char)MobiDOT::Font::BITWISE;
+
+        memcpy(data + size, framebuffer.getBand(i), width);
+        size += width;
+    }
+
+    this->addFooter(data, size);
+    return size;
+}
+
+bool MobiDOT::send(const char data[], uint size, MobiDOT::Priority priority)
+{
+    // Frames always start with the start byte followed by the address
+    MobiDOT::Display type;
+    if (size < 2 || data[0] != (char)MOBIDOT_BYTE_START || !this->findDisplay(data[1], type))
+    {
+        return false;
+    }
+
+    return this->sendBuffer(type, data, size, priority);
+}
+
+void MobiDOT::loop()
+{
+    // Pick the oldest frame of the highest priority that is queued
+    int priority = MOBIDOT_PRIORITY_COUNT - 1;
+    int next = -1;
+    for (; priority >= 0 && next < 0; priority--)
+    {
+        for (uint i = 0; i < MOBIDOT_DISPLAY_COUNT; i++)
+        {
+            const Frame &frame = this->QUEUE[priority][i];
+            if (frame.data != nullptr && (next < 0 || (long)(frame.queued - this->QUEUE[priority][next].queued) < 0))
+            {
+                next = i;
+            }
+        }
+    }
+    priority++; // Undo the last decrement of the loop
+
+    if (this->ACTIVE.data != nullptr && next >= 0 && priority > (int)this->ACTIVE_PRIORITY)
+    {
+        this->abortFrame();
+    }
+
+    // Start the next frame if the bus is free
+    if (this->ACTIVE.data == nullptr)
+    {
+        if (next < 0)
+        {
+            return;
+        }
+
+        Frame &frame = this->QUEUE[priority][next];
+        this->ACTIVE = frame;
+        this->ACTIVE_PRIORITY = (MobiDOT::Priority)priority;
+        this->ACTIVE_DISPLAY = (MobiDOT::Display)next;
+        this->ACTIVE_POSITION = 0;
+        this->ACTIVE_TIME = 0;
+        frame = Frame();
+
+        digitalWrite(this->PIN_CTRL, RS485_TX_PIN_VALUE); // Set RS485 module to transmit
+        MOBIDOT_TRACE_BEGIN("transmit", BUS);
+    }
+
+    // Write the next chunk
+    const uint length = min((uint)RS485_CHUNK_SIZE, this->ACTIVE.size - this->ACTIVE_POSITION);
+    const unsigned long start = micros();
+    const size_t result = this->RS485.write(this->ACTIVE.data + this->ACTIVE_POSITION, length);
+    this->ACTIVE_TIME += micros() - start;
+
+    if (result != length)
+    {
+        // Bus error, end the frame so the display discards what it got so far
+        this->ACTIVE_POSITION += result;
+        this->abortFrame();
+        return;
+    }
+
+    this->ACTIVE_POSITION += length;
+    if (this->ACTIVE_POSITION >= this->ACTIVE.size)
+    {
+        this->finishFrame();
+    }
+}
+
+bool MobiDOT::isBusy()
+{
+    if (this->ACTIVE.data != nullptr)
+    {
+        return true;
+    }
+
+    for (uint i = 0; i < MOBIDOT_PRIORITY_COUNT; i++)
+    {
+        for (uint j = 0; j < MOBIDOT_DISPLAY_COUNT; j++)
+        {
+            if (this->QUEUE[i][j].data != nullptr)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool MobiDOT::isBusy(MobiDOT::Display type)
+{
+    if (this->ACTIVE.data != nullptr && this->ACTIVE_DISPLAY == type)
+    {
+        return true;
+    }
+
+    for (uint i = 0; i < MOBIDOT_PRIORITY_COUNT; i++)
+    {
+        if (this->QUEUE[i][(uint)type].data != nullptr)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MobiDOT::flush()
+{
+    while (this->isBusy())
+    {
+        this->loop();
+        yield();
+    }
+}
+
+uint32_t MobiDOT::getLatency(MobiDOT::Priority priority, bool maximum)
+{
+    return (maximum) ? this->LATENCY_MAX[(uint)priority] : this->LATENCY[(uint)priority];
+}
+
+uint32_t MobiDOT::getSentFrames()
+{
+    return this->SENT_FRAMES;
+}
+
+uint32_t MobiDOT::getCoalescedFrames()
+{
+    return this->COALESCED_FRAMES;
+}
+
+uint32_t MobiDOT::getDroppedFrames()
+{
+    return this->DROPPED_FRAMES;
+}
+
+const MobiDOTBands &MobiDOT::getFramebuffer(MobiDOT::Display type)
+{
+    return *this->FRAMEBUFFER[(uint)type];
+}
+
+uint32_t MobiDOT::getFrameVersion(MobiDOT::Display type)
+{
+    return this->FRAME_VERSION[(uint)type];
+}
+
+uint8_t MobiDOT::getChangedBands(MobiDOT::Display type)
+{
+    return this->FRAME_CHANGED[(uint)type];
+}
+
+void MobiDOT::onFrame(FrameCallback callback)
+{
+    this->FRAME_CALLBACK = callback;
+}
+
+void MobiDOT::clear(bool value)
+{
     const uint height = this->display[(uint)this->DISPLAY_DEFAULT].height;
     const uint width = this->display[(uint)this->DISPLAY_DEFAULT].width;
 
+    this->clearRect(width, height, 0, 0, value);
+}
+
+void MobiDOT::clearRect(uint width, uint height, int x, int y, bool value)
+{
+    // Check if the current buffer is empty, if so add the MobiDOT header
+    this->beginFrame();
+
+    uint *size = &this->BUFFER_SIZE;
+
     for (size_t i = 0; i < ceil((float)height / 5); i++)
     {
         this->BUFFER_DATA[(*size)++] = 0xd2;
-        this->BUFFER_DATA[(*size)++] = 0;
+        this->BUFFER_DATA[(*size)++] = x;
         this->BUFFER_DATA[(*size)++] = 0xd3;
-        this->BUFFER_DATA[(*size)++] = 4 + (i * 5);
+        this->BUFFER_DATA[(*size)++] = y + 4 + (i * 5);
         this->BUFFER_DATA[(*size)++] = 0xd4;
         this->BUFFER_DATA[(*size)++] = (char)MobiDOT::Font::BITWISE;
 
@@ -420,6 +785,219 @@ void MobiDOT::clear(bool value)
     }
 }
 
+bool MobiDOT::addWidget(MobiDOT::Display type, MobiDOTWidget *widget)
+{
+    MobiDOTWidget **widgets = this->WIDGETS[(uint)type];
+
+    for (size_t i = 0; i < MOBIDOT_WIDGET_COUNT; i++)
+    {
+        if (widgets[i] == nullptr)
+        {
+            widgets[i] = widget;
+
+            // Make sure the widget is rendered for this display on the next update
+            widget->invalidate();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MobiDOT::removeWidget(MobiDOT::Display type, MobiDOTWidget *widget)
+{
+    MobiDOTWidget **widgets = this->WIDGETS[(uint)type];
+
+    for (size_t i = 0; i < MOBIDOT_WIDGET_COUNT; i++)
+    {
+        if (widgets[i] == widget)
+        {
+            widgets[i] = nullptr;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MobiDOT::hasWidgets(MobiDOT::Display type)
+{
+    for (const MobiDOTWidget *widget : this->WIDGETS[(uint)type])
+    {
+        if (widget != nullptr)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MobiDOT::isBufferEmpty()
+{
+    return this->BUFFER_SIZE == 0;
+}
+
+void MobiDOT::drawBands(const MobiDOTBands &bands, int x, int y)
+{
+    this->drawBands(bands, 0, bands.getWidth(), x, y);
+}
+
+void MobiDOT::drawBands(const MobiDOTBands &bands, uint srcX, uint width, int x, int y)
+{
+    MOBIDOT_TRACE_SCOPE("drawBands");
+    // Nothing of the bands is left to draw, the width would wrap below
+    if (srcX >= bands.getWidth())
+    {
+        return;
+    }
+
+    // Check if the current buffer is empty, if so add the MobiDOT header
+    this->beginFrame();
+
+    this->addBands(this->BUFFER_DATA, this->BUFFER_SIZE, bands, srcX, width, x, y);
+}
+
+void MobiDOT::drawBandsChanged(const MobiDOTBands &bands, uint srcX, const MobiDOTBands &previous, uint previousX, uint width, int x, int y)
+{
+    MOBIDOT_TRACE_SCOPE("drawBandsChanged");
+    // Nothing of the bands is left to compare, the width would wrap below
+    if (srcX >= bands.getWidth() || previousX >= previous.getWidth())
+    {
+        return;
+    }
+
+    // Check if the current buffer is empty, if so add the MobiDOT header
+    this->beginFrame();
+
+    this->addBandsChanged(this->BUFFER_DATA, this->BUFFER_SIZE, bands, srcX, previous, previousX, width, x, y);
+}
+
+bool MobiDOT::sendBands(MobiDOT::Display type, const MobiDOTBands &bands, uint srcX, uint width, int x, int y,
+                        MobiDOT::Priority priority)
+{
+    MOBIDOT_TRACE_SCOPE("sendBands");
+    if (srcX >= bands.getWidth())
+    {
+        return false;
+    }
+    width = min(width, bands.getWidth() - srcX);
+
+    uint size = 0;
+    char *data = new char[MOBIDOT_FRAME_OVERHEAD + bands.getBands() * (MOBIDOT_SEGMENT_HEADER + width)];
+    this->addHeader(type, data, size);
+    this->addBands(data, size, bands, srcX, width, x, y);
+
+    return this->sendSegments(type, data, size, priority);
+}
+
+bool MobiDOT::sendBandsChanged(MobiDOT::Display type, const MobiDOTBands &bands, uint srcX, const MobiDOTBands &previous,
+                               uint previousX, uint width, int x, int y, MobiDOT::Priority priority)
+{
+    MOBIDOT_TRACE_SCOPE("sendBandsChanged");
+    if (srcX >= bands.getWidth() || previousX >= previous.getWidth())
+    {
+        return false;
+    }
+    width = min(width, min(bands.getWidth() - srcX, previous.getWidth() - previousX));
+
+    // Changed runs are only split by at least MOBIDOT_SEGMENT_HEADER unchanged columns, so a band never takes more
+    // than one segment header on top of its columns
+    uint size = 0;
+    char *data = new char[MOBIDOT_FRAME_OVERHEAD + bands.getBands() * (MOBIDOT_SEGMENT_HEADER + width)];
+    this->addHeader(type, data, size);
+    this->addBandsChanged(data, size, bands, srcX, previous, previousX, width, x, y);
+
+    return this->sendSegments(type, data, size, priority);
+}
+
+void MobiDOT::addBands(char data[], uint &size, const MobiDOTBands &bands, uint srcX, uint width, int x, int y)
+{
+    width = min(width, bands.getWidth() - srcX);
+
+    for (uint i = 0; i < bands.getBands(); i++)
+    {
+        this->addSegment(data, size, x, y + (i * MOBIDOT_BAND_HEIGHT), bands.getBand(i) + srcX, width);
+    }
+}
+
+void MobiDOT::addBandsChanged(char data[], uint &size, const MobiDOTBands &bands, uint srcX, const MobiDOTBands &previous,
+                              uint previousX, uint width, int x, int y)
+{
+    width = min(width, min(bands.getWidth() - srcX, previous.getWidth() - previousX));
+    const uint count = min(bands.getBands(), previous.getBands());
+
+    for (uint i = 0; i < count; i++)
+    {
+        const uint8_t *current = bands.getBand(i) + srcX;
+        const uint8_t *shown = previous.getBand(i) + previousX;
+
+        uint j = 0;
+        while (j < width)
+        {
+            // Skip columns that did not change
+            if (current[j] == shown[j])
+            {
+                j++;
+                continue;
+            }
+
+            // Extend the run, gaps shorter than a segment header are cheaper to send along
+            const uint start = j;
+            uint end = j + 1;
+            while (end < width)
+            {
+                uint next = end;
+                while (next < width && current[next] == shown[next] && next - end < MOBIDOT_SEGMENT_HEADER)
+                {
+                    next++;
+                }
+
+                if (next >= width || current[next] == shown[next])
+                {
+                    break;
+                }
+                end = next + 1;
+            }
+
+            this->addSegment(data, size, x + start, y + (i * MOBIDOT_BAND_HEIGHT), current + start, end - start);
+            j = end;
+        }
+    }
+}
+
+bool MobiDOT::sendSegments(MobiDOT::Display type, char data[], uint size, MobiDOT::Priority priority)
+{
+    // Nothing changed, do not send just a header
+    bool result = false;
+    if (size > MOBIDOT_FRAME_HEADER)
+    {
+        this->addFooter(data, size);
+        result = this->sendBuffer(type, data, size, priority);
+    }
+
+    delete[] data;
+    return result;
+}
+
+void MobiDOT::drawCanvas(const MobiDOTCanvas &canvas, bool changed)
+{
+    MOBIDOT_TRACE_SCOPE("drawCanvas");
+    MobiDOTBands bands(canvas.getWidth(), canvas.getHeight());
+    canvas.pack(bands);
+
+    if (changed)
+    {
+        this->drawBandsChanged(bands, 0, *this->FRAMEBUFFER[(uint)this->DISPLAY_DEFAULT], 0, bands.getWidth(), 0, 0);
+    }
+    else
+    {
+        this->drawBands(bands);
+    }
+}
+
+uint32_t MobiDOT::getThroughput()
+{
+    return this->THROUGHPUT;
+}
+
 void MobiDOT::drawBitmap(const unsigned char data[], uint width, uint height, bool invert)
 {
     this->drawBitmap(data, width, height, 0, 0, invert);
@@ -427,11 +1005,9 @@ void MobiDOT::drawBitmap(const unsigned char data[], uint width, uint height, bo
 
 void MobiDOT::drawBitmap(const unsigned char data[], uint width, uint height, int x, int y, bool invert)
 {
+    MOBIDOT_TRACE_SCOPE("drawBitmap");
     // Check if the current buffer is empty, if so add the MobiDOT header
-    if (this->BUFFER_DATA[0] != 0xff)
-    {
-        this->addHeader(this->DISPLAY_DEFAULT, this->BUFFER_DATA, this->BUFFER_SIZE);
-    }
+    this->beginFrame();
 
     uint *size = &this->BUFFER_SIZE;
     const uint16_t bytesOverWidth = ceil(width / 8.0);
@@ -513,8 +1089,80 @@ void MobiDOT::addHeader(MobiDOT::Display type, char data[], uint &size)
     return;
 }
 
+void MobiDOT::beginFrame()
+{
+    if (this->BUFFER_SIZE == 0)
+    {
+        this->addHeader(this->DISPLAY_DEFAULT, this->BUFFER_DATA, this->BUFFER_SIZE);
+    }
+}
+
+void MobiDOT::addWidgets(MobiDOT::Display type)
+{
+    MobiDOTWidget **widgets = this->WIDGETS[(uint)type];
+
+    for (size_t i = 0; i < MOBIDOT_WIDGET_COUNT; i++)
+    {
+        MobiDOTWidget *widget = widgets[i];
+        if (widget == nullptr)
+        {
+            continue;
+        }
+
+        // Header goes in front of the first widget, never inside the cached output of a widget
+        this->beginFrame();
+
+        if (widget->DIRTY)
+        {
+            // Render the widget and keep a copy of the commands it added
+            const uint start = this->BUFFER_SIZE;
+            widget->draw(*this);
+            const uint length = this->BUFFER_SIZE - start;
+
+            if (length != widget->CACHE_SIZE)
+            {
+                delete[] widget->CACHE_DATA;
+                widget->CACHE_DATA = (length) ? new char[length] : nullptr;
+                widget->CACHE_SIZE = length;
+            }
+            memcpy(widget->CACHE_DATA, this->BUFFER_DATA + start, length);
+            widget->DIRTY = false;
+        }
+        else
+        {
+            // Nothing changed, reuse the cached commands. Leave room for the footer
+            if (this->BUFFER_SIZE + widget->CACHE_SIZE + 5 > RS485_BUFFER_SIZE)
+            {
+                continue;
+            }
+            memcpy(this->BUFFER_DATA + this->BUFFER_SIZE, widget->CACHE_DATA, widget->CACHE_SIZE);
+            this->BUFFER_SIZE += widget->CACHE_SIZE;
+        }
+    }
+}
+
+void MobiDOT::addSegment(char data[], uint &size, int x, int y, const uint8_t columns[], uint length)
+{
+    // Leave room for the footer
+    if (size + MOBIDOT_SEGMENT_HEADER + length + MOBIDOT_FRAME_OVERHEAD > RS485_BUFFER_SIZE)
+    {
+        return;
+    }
+
+    data[size++] = 0xd2;
+    data[size++] = x;
+    data[size++] = 0xd3;
+    data[size++] = y + 4;
+    data[size++] = 0xd4;
+    data[size++] = (char)MobiDOT::Font::BITWISE;
+
+    memcpy(data + size, columns, length);
+    size += length;
+}
+
 void MobiDOT::addFooter(char data[], uint &size)
 {
+    MOBIDOT_TRACE_SCOPE("addFooter");
     uint checksum = 0;
     for (size_t i = 1; i < size; i++)
     {
@@ -543,13 +1191,332 @@ void MobiDOT::addFooter(char data[], uint &size)
     return;
 }
 
-bool MobiDOT::sendBuffer(char data[], uint size)
+bool MobiDOT::findDisplay(char address, MobiDOT::Display &type)
+{
+    for (uint i = 0; i < MOBIDOT_DISPLAY_COUNT; i++)
+    {
+        if (this->display[i].address == address)
+        {
+            type = (MobiDOT::Display)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint MobiDOT::findFooter(const char data[], uint size)
+{
+    // The footer is the checksum (escaped if needed), stop byte and a trailing zero
+    uint footer = size;
+    while (footer > 0 && data[footer - 1] != (char)MOBIDOT_BYTE_STOP)
+    {
+        footer--;
+    }
+
+    if (footer < 2)
+    {
+        return 0;
+    }
+    return (footer >= 3 && data[footer - 3] == (char)0xfe) ? footer - 3 : footer - 2;
+}
+
+void MobiDOT::applyFrame(MobiDOT::Display type, const char data[], uint size)
+{
+    MOBIDOT_TRACE_SCOPE("applyFrame");
+    MobiDOTBands *framebuffer = this->FRAMEBUFFER[(uint)type];
+    const uint footer = this->findFooter(data, size);
+
+    uint8_t changed = 0;
+    int x = 0;
+    int y = 0;
+    bool bitwise = false;
+
+    // Skip start byte, address and mode
+    for (uint i = 3; i < footer; i++)
+    {
+        const uint8_t value = data[i];
+
+        // Commands take one argument
+        if (value >= 0xd0 && value <= 0xd4 && i + 1 < footer)
+        {
+            const uint8_t argument = data[++i];
+            if (value == 0xd2)
+            {
+                x = argument;
+            }
+            else if (value == 0xd3)
+            {
+                y = argument - 4; // Top row of the segment
+            }
+            else if (value == 0xd4)
+            {
+                bitwise = (argument == (uint8_t)MobiDOT::Font::BITWISE);
+            }
+            continue;
+        }
+
+        if (!bitwise)
+        {
+            continue;
+        }
+
+        // Every BITWISE byte writes a column of a band, bit 0 is the top row
+        for (uint8_t k = 0; k < MOBIDOT_BAND_HEIGHT; k++)
+        {
+            const int row = y + k;
+            if (x >= (int)framebuffer->getWidth() || row < 0 || row >= (int)framebuffer->getHeight())
+            {
+                continue;
+            }
+
+            const bool on = value >> k & 0x01;
+            if (framebuffer->getPixel(x, row) != on)
+            {
+                framebuffer->setPixel(x, row, on);
+                changed |= 0x01 << (row / MOBIDOT_BAND_HEIGHT);
+            }
+        }
+        x++;
+    }
+
+    this->FRAME_CHANGED[(uint)type] = changed;
+    if (changed)
+    {
+        this->FRAME_VERSION[(uint)type]++;
+    }
+}
+
+bool MobiDOT::sendBuffer(MobiDOT::Display type, const char data[], uint size, MobiDOT::Priority priority)
 {
-    digitalWrite(this->PIN_CTRL, RS485_TX_PIN_VALUE); // Set RS485 module to transmit
-    size_t result = this->RS485.write(data, size);    // Write data
+    MOBIDOT_TRACE_SCOPE("sendBuffer");
+    if (size == 0)
+    {
+        return false;
+    }
+
+    Frame &frame = this->QUEUE[(uint)priority][(uint)type];
+    if (frame.data != nullptr)
+    {
+        // Nothing of the queued frame would stay visible, the newer frame replaces it
+        if (this->coversDisplay(type, data, size))
+        {
+            this->COALESCED_FRAMES++;
+            delete[] frame.data;
+        }
+        // A partial frame only changes part of the display, it has to be sent after the queued frame
+        else if (this->mergeFrame(frame, data, size))
+        {
+            this->COALESCED_FRAMES++;
+            return true;
+        }
+        else
+        {
+            this->DROPPED_FRAMES++;
+            return false;
+        }
+    }
+
+    frame.data = new char[size];
+    frame.size = size;
+    frame.queued = micros();
+    memcpy(frame.data, data, size);
+
+    return true;
+}
+
+bool MobiDOT::coversDisplay(MobiDOT::Display type, const char data[], uint size)
+{
+    const uint footer = this->findFooter(data, size);
+    const uint width = this->display[(uint)type].width;
+    const uint height = this->display[(uint)type].height;
+
+    for (uint top = 0; top < height; top += MOBIDOT_BAND_HEIGHT)
+    {
+        // Columns of this band set from the left edge on
+        uint covered = 0;
+        int x = 0;
+        int y = 0;
+        bool bitwise = false;
+
+        // Skip start byte, address and mode
+        for (uint i = 3; i < footer && covered < width; i++)
+        {
+            const uint8_t value = data[i];
+
+            // Commands take one argument
+            if (value >= 0xd0 && value <= 0xd4 && i + 1 < footer)
+            {
+                const uint8_t argument = data[++i];
+                if (value == 0xd2)
+                {
+                    x = argument;
+                }
+                else if (value == 0xd3)
+                {
+                    y = argument - 4; // Top row of the segment
+                }
+                else if (value == 0xd4)
+                {
+                    bitwise = (argument == (uint8_t)MobiDOT::Font::BITWISE);
+                }
+                continue;
+            }
+
+            if (!bitwise)
+            {
+                continue;
+            }
+
+            if (y == (int)top && x == (int)covered)
+            {
+                covered++;
+            }
+            x++;
+        }
+
+        if (covered < width)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool MobiDOT::mergeFrame(Frame &frame, const char data[], uint size)
+{
+    MOBIDOT_TRACE_SCOPE("mergeFrame");
+    const uint footer = this->findFooter(frame.data, frame.size);
+    const uint end = this->findFooter(data, size);
+
+    // Both frames have to start with the same header, it is only sent once
+    if (footer < MOBIDOT_FRAME_HEADER || end < MOBIDOT_FRAME_HEADER || memcmp(frame.data, data, MOBIDOT_FRAME_HEADER) != 0)
+    {
+        return false;
+    }
+
+    uint length = footer + end - MOBIDOT_FRAME_HEADER;
+    if (length + MOBIDOT_FRAME_OVERHEAD - MOBIDOT_FRAME_HEADER > RS485_BUFFER_SIZE)
+    {
+        return false;
+    }
+
+    char *merged = new char[length + MOBIDOT_FRAME_OVERHEAD - MOBIDOT_FRAME_HEADER];
+    memcpy(merged, frame.data, footer);
+    memcpy(merged + footer, data + MOBIDOT_FRAME_HEADER, end - MOBIDOT_FRAME_HEADER);
+    this->addFooter(merged, length);
+
+    delete[] frame.data;
+    frame.data = merged;
+    frame.size = length;
+    return true;
+}
+
+void MobiDOT::abortFrame()
+{
+    Frame &frame = this->ACTIVE;
+
+    // Once the footer is being sent the frame is finished instead, it only takes a few more bytes
+    const uint footer = this->findFooter(frame.data, frame.size);
+
+    if (this->ACTIVE_POSITION > footer)
+    {
+        this->RS485.write(frame.data + this->ACTIVE_POSITION, frame.size - this->ACTIVE_POSITION);
+        this->finishFrame();
+        return;
+    }
+
+    // Anything sent so far gets terminated by a checksum that is guaranteed to be wrong
+    if (this->ACTIVE_POSITION > 0)
+    {
+        uint checksum = 0;
+        for (size_t i = 1; i < this->ACTIVE_POSITION; i++)
+        {
+            checksum += frame.data[i];
+        }
+        checksum = (checksum + 1) & 0xff;
+
+        // Wrong checksums must not be mistaken for an escape or stop byte either
+        if (checksum >= 0xfe)
+        {
+            checksum = 0x00;
+        }
+
+        const char terminator[] = {(char)checksum, (char)MOBIDOT_BYTE_STOP, 0x00};
+        this->RS485.write(terminator, sizeof(terminator));
+    }
     digitalWrite(this->PIN_CTRL, RS485_RX_PIN_VALUE); // Set RS485 module to receive
+    MOBIDOT_TRACE_END("transmit", BUS);
+    MOBIDOT_TRACE_INSTANT("abort", BUS);
+
+    // Send the frame again later, in front of a newer frame for this display that is waiting already. Frames of a
+    // higher priority are sent first, so if one is waiting for this display the preempted frame has to go in front of
+    // that one instead, or its older content would be drawn over the newer content
+    const uint display = (uint)this->ACTIVE_DISPLAY;
+    Frame *target = &this->QUEUE[(uint)this->ACTIVE_PRIORITY][display];
+    for (uint i = (uint)this->ACTIVE_PRIORITY + 1; i < MOBIDOT_PRIORITY_COUNT; i++)
+    {
+        if (this->QUEUE[i][display].data != nullptr)
+        {
+            target = &this->QUEUE[i][display];
+        }
+    }
 
-    // Check if returned amount of bytes is equal to the input
-    // If not, something went wrong and this will return false
-    return (result == size);
-}
\ No newline at end of file
+    Frame &queued = *target;
+    if (queued.data == nullptr)
+    {
+        queued = frame;
+    }
+    else if (this->coversDisplay(this->ACTIVE_DISPLAY, queued.data, queued.size))
+    {
+        this->COALESCED_FRAMES++;
+        delete[] frame.data;
+    }
+    else if (this->mergeFrame(frame, queued.data, queued.size))
+    {
+        // The merged frame is sent in the place of the waiting frame
+        this->COALESCED_FRAMES++;
+        frame.queued = queued.queued;
+        delete[] queued.data;
+        queued = frame;
+    }
+    else
+    {
+        this->DROPPED_FRAMES++;
+        delete[] frame.data;
+    }
+    frame = Frame();
+}
+
+void MobiDOT::finishFrame()
+{
+    Frame &frame = this->ACTIVE;
+
+    digitalWrite(this->PIN_CTRL, RS485_RX_PIN_VALUE); // Set RS485 module to receive
+    MOBIDOT_TRACE_END("transmit", BUS);
+
+    // Latency from queueing until the last byte left
+    const uint32_t latency = (micros() - frame.queued) / 1000;
+    const uint priority = (uint)this->ACTIVE_PRIORITY;
+    this->LATENCY[priority] = latency;
+    this->LATENCY_MAX[priority] = max(this->LATENCY_MAX[priority], latency);
+
+    // Keep a running average of the bus speed, used to pace animations
+    if (this->ACTIVE_TIME > 0)
+    {
+        const uint32_t measured = (uint64_t)frame.size * 1000000 / this->ACTIVE_TIME;
+        this->THROUGHPUT = (this->THROUGHPUT * 3 + measured) / 4;
+    }
+
+    this->SENT_FRAMES++;
+    this->applyFrame(this->ACTIVE_DISPLAY, frame.data, frame.size);
+
+    if (this->FRAME_CALLBACK)
+    {
+        MOBIDOT_TRACE_SCOPE("onFrame");
+        this->FRAME_CALLBACK(this->ACTIVE_DISPLAY, frame.data, frame.size);
+    }
+
+    delete[] frame.data;
+    frame = Frame();
+}
@@ -7,8 +7,12 @@
  * Copyright (c) 2021 Arne van Iterson
  */
 
+#ifndef _MOBIDOT_HPP_
+#define _MOBIDOT_HPP_
+
 #include <Arduino.h>
 #include <SoftwareSerial.h>
+#include <functional>
 #include "gfxfont/gfxfont.h"
 
 /* Library constants */
@@ -20,6 +24,18 @@
 #define RS485_BAUDRATE 4800
 #define RS485_BUFFER_SIZE 2048
 
+/* Transmitter constants, bytes written per call of loop(). Smaller chunks preempt faster but cost more calls */
+#define RS485_CHUNK_SIZE 16
+#define MOBIDOT_PRIORITY_COUNT 3
+
+/* Protocol overhead, the header and footer of a frame and the header of a BITWISE segment */
+#define MOBIDOT_FRAME_OVERHEAD 12
+#define MOBIDOT_FRAME_HEADER 7
+#define MOBIDOT_SEGMENT_HEADER 6
+
+/* Widget constants */
+#define MOBIDOT_WIDGET_COUNT 8
+
 /* Protocol constants */
 #define MOBIDOT_BYTE_START 0xff
 #define MOBIDOT_BYTE_STOP 0xff
@@ -40,6 +56,21 @@
 #define MOBIDOT_WIDTH_SIDE 84
 #define MOBIDOT_HEIGHT_SIDE 7
 
+/* Amount of displays defined in MobiDOT::Display */
+#define MOBIDOT_DISPLAY_COUNT 3
+
+// Retained widgets, see widget.hpp
+class MobiDOTWidget;
+
+// Band packed pixel buffer, see bands.hpp
+class MobiDOTBands;
+
+// GFXfont converted at compile time, see bandfont.hpp
+struct MobiDOTBandFont;
+
+// Word packed canvas with a blitter, see canvas.hpp
+class MobiDOTCanvas;
+
 /**
  * @class MobiDOT class
  */
@@ -57,6 +88,17 @@ public:
         SIDE
     };
 
+    /**
+     * @enum Priority
+     * Contains frame priorities, a frame preempts frames of a lower priority that are being sent
+     */
+    enum class Priority
+    {
+        BACKGROUND,
+        NORMAL,
+        URGENT
+    };
+
     /**
      * @enum Font
      * Contains all fonts available in ASCII mode
@@ -106,6 +148,21 @@ public:
      */
     void selectDisplay(MobiDOT::Display type);
 
+    /**
+     * getWidth and getHeight functions
+     * @param type MobiDOT::Display type
+     * @returns Width or height of the display in pixels
+     */
+    uint getWidth(MobiDOT::Display type);
+    uint getHeight(MobiDOT::Display type);
+
+    /**
+     * getAddress function
+     * @param type MobiDOT::Display type
+     * @returns Bus address of the display, the second byte of its frames
+     */
+    char getAddress(MobiDOT::Display type);
+
     /**
      * setLight function
      * Sets the light pin set when calling the constructor high or low depending on parameter state.
@@ -140,12 +197,193 @@ public:
     void print(const char c[], const GFXfont *font, bool invert = false);
     void print(const char c[], const GFXfont *font, int offsetX, int offsetY, bool invert = false);
 
+    /**
+     * print function
+     * Prints a string using a GFXfont converted at compile time using MOBIDOT_BAND_FONT.
+     * Unlike the GFXfont version the string is aligned to the top of the font cell, not to its highest char
+     * @param c[] String to print
+     * @param font Converted font
+     * @param offsetX Horizontal offset (optional, will print at 0, 0 when not specified)
+     * @param offsetY Vertical offset (see offsetX)
+     * @param invert Invert text
+     */
+    void print(const char c[], const MobiDOTBandFont &font, bool invert = false);
+    void print(const char c[], const MobiDOTBandFont &font, int offsetX, int offsetY, bool invert = false);
+
     /**
      * update function
-     * Send the current display buffer to the display
-     * @returns True or false based on wether the transfer was successfull
+     * Queues the current display buffer for sending to the display, the transfer happens in loop().
+     * Widgets added to the selected display are drawn on top of the buffer, only widgets that were invalidated
+     * since the last update are rendered again, the others reuse their cached output.
+     * A frame that sets every pixel of the display replaces a frame of the same priority for the same display that
+     * did not start sending yet, any other frame is appended to it so both are sent as one frame
+     * @param priority Priority of the frame (optional, NORMAL if not specified)
+     * @returns True if the frame was queued, false if there was nothing to send or it did not fit behind the queued
+     * frame, see getDroppedFrames()
      */
-    bool update();
+    bool update(MobiDOT::Priority priority = MobiDOT::Priority::NORMAL);
+
+    /**
+     * encode function
+     * Finishes the current display buffer like update() does, but hands the frame to the caller instead of queueing it.
+     * Pass it to send() later, so the encoding work can be done ahead of time
+     * @param data Set to a new buffer holding the frame including header and footer, delete[] it when done.
+     * nullptr if there was nothing to encode
+     * @returns Size of the frame, 0 if there was nothing to encode
+     */
+    uint encode(char *&data);
+
+    /**
+     * encodeFramebuffer function
+     * Encodes what a display shows according to getFramebuffer() as one frame covering the entire display.
+     * The current display buffer is left untouched
+     * @param type MobiDOT::Display type
+     * @param data Set to a new buffer holding the frame including header and footer, delete[] it when done
+     * @returns Size of the frame
+     */
+    uint encodeFramebuffer(MobiDOT::Display type, char *&data);
+
+    /**
+     * send function
+     * Queues a complete frame that was encoded before, e.g. a frame stored by a FrameCallback.
+     * The frame has to include the MobiDOT header and footer, the current display buffer is left untouched.
+     * Replaces or is appended to a queued frame like with update()
+     * @param data Frame data, copied
+     * @param size Size of the frame data
+     * @param priority Priority of the frame (optional, NORMAL if not specified)
+     * @returns True if the frame was queued
+     */
+    bool send(const char data[], uint size, MobiDOT::Priority priority = MobiDOT::Priority::NORMAL);
+
+    /**
+     * loop function
+     * Sends the next RS485_CHUNK_SIZE bytes of the queued frames, call this from loop().
+     * If a frame of a higher priority is queued, the frame being sent is aborted first. The aborted frame gets a wrong
+     * checksum so the display discards it and is sent again in front of the next frame for that display, which can be
+     * the frame of the higher priority. It is left out if that frame sets every pixel of the display
+     */
+    void loop();
+
+    /**
+     * isBusy function
+     * @returns True if a frame is being sent or queued
+     */
+    bool isBusy();
+
+    /**
+     * isBusy function
+     * @param type MobiDOT::Display type
+     * @returns True if a frame for the display is being sent or queued, so getFramebuffer() is not final yet
+     */
+    bool isBusy(MobiDOT::Display type);
+
+    /**
+     * flush function
+     * Blocks until all queued frames are sent
+     */
+    void flush();
+
+    /**
+     * getLatency function
+     * Returns the time between queueing and completely sending the last frame of a priority
+     * @param priority Frame priority
+     * @param maximum Return the highest latency measured instead of the last one
+     * @returns Latency in milliseconds
+     */
+    uint32_t getLatency(MobiDOT::Priority priority, bool maximum = false);
+
+    /**
+     * getSentFrames function
+     * @returns Amount of frames sent successfully since boot
+     */
+    uint32_t getSentFrames();
+
+    /**
+     * getCoalescedFrames function
+     * @returns Amount of frames that were not sent on their own: replaced by a newer frame for the same display and
+     * priority that sets every pixel, or appended to another frame and sent as part of it
+     */
+    uint32_t getCoalescedFrames();
+
+    /**
+     * getDroppedFrames function
+     * Frames are dropped when appending them to the queued frame of the same display would not fit in
+     * RS485_BUFFER_SIZE: a new frame is refused by update() or send(), a frame preempted halfway through is lost
+     * @returns Amount of frames that never reached the display
+     */
+    uint32_t getDroppedFrames();
+
+    /**
+     * getFramebuffer function
+     * Returns what the display shows according to the frames sent so far, updated before the frame callback is called.
+     * Only BITWISE segments are tracked, text in fonts built into the display is not rendered
+     * @param type MobiDOT::Display type
+     * @returns Band packed buffer with the size of the display
+     */
+    const MobiDOTBands &getFramebuffer(MobiDOT::Display type);
+
+    /**
+     * getFrameVersion function
+     * @param type MobiDOT::Display type
+     * @returns Counter that increases every time a sent frame changed the framebuffer of the display
+     */
+    uint32_t getFrameVersion(MobiDOT::Display type);
+
+    /**
+     * getChangedBands function
+     * @param type MobiDOT::Display type
+     * @returns Bit mask of the bands of the framebuffer that changed with the last frame sent to the display, bit 0 is the top band
+     */
+    uint8_t getChangedBands(MobiDOT::Display type);
+
+    /**
+     * FrameCallback type
+     * Called after a frame was sent successfully
+     * @param type Display the frame was sent to
+     * @param data Frame data as sent over the bus, including header and footer
+     * @param size Size of the frame data
+     */
+    typedef std::function<void(MobiDOT::Display type, const char data[], uint size)> FrameCallback;
+
+    /**
+     * onFrame function
+     * Sets the function that is called after a frame was sent successfully, e.g. to store it.
+     * The data is only valid during the call
+     * @param callback Callback function, nullptr to remove the current callback
+     */
+    void onFrame(FrameCallback callback);
+
+    /**
+     * addWidget function
+     * Adds a retained widget to a display, the widget will be drawn on every update() of that display.
+     * The widget is not copied, it has to stay alive until it is removed again
+     * @param type MobiDOT::Display type
+     * @param widget Widget to add
+     * @returns True if the widget was added, false if the display already holds MOBIDOT_WIDGET_COUNT widgets
+     */
+    bool addWidget(MobiDOT::Display type, MobiDOTWidget *widget);
+
+    /**
+     * removeWidget function
+     * Removes a widget from a display
+     * @param type MobiDOT::Display type
+     * @param widget Widget to remove
+     * @returns True if the widget was removed, false if it was not added to this display
+     */
+    bool removeWidget(MobiDOT::Display type, MobiDOTWidget *widget);
+
+    /**
+     * hasWidgets function
+     * @param type MobiDOT::Display type
+     * @returns True if widgets were added to the display, so its frames depend on more than what was drawn
+     */
+    bool hasWidgets(MobiDOT::Display type);
+
+    /**
+     * isBufferEmpty function
+     * @returns True if nothing was drawn since the last update(), so the next frame holds only what is drawn next
+     */
+    bool isBufferEmpty();
 
     /**
      * clear function
@@ -154,6 +392,18 @@ public:
      */
     void clear(bool value = false);
 
+    /**
+     * clearRect function
+     * Clears an area of the currently selected display
+     * Keep in mind that the display is written in rows of 5 pixels, the height is rounded up to a multiple of 5
+     * @param width Width of the area
+     * @param height Height of the area
+     * @param x Horizontal offset
+     * @param y Vertical offset
+     * @param value Determines wether all dots will be turned 'on' (yellow side) or 'off' (black side)
+     */
+    void clearRect(uint width, uint height, int x, int y, bool value = false);
+
     /**
      * drawBitmap function
      * Draws a bitmap image encoded using image2cpp on the specified coordinates
@@ -167,6 +417,67 @@ public:
     void drawBitmap(const unsigned char data[], uint width, uint height, bool invert = false);
     void drawBitmap(const unsigned char data[], uint width, uint height, int x, int y, bool invert = false);
 
+    /**
+     * drawBands function
+     * Draws a band packed buffer, or a window of it, on the specified coordinates.
+     * The buffer is already in the format of the display, so this only copies bytes
+     * @param bands Band packed buffer
+     * @param srcX First column of the buffer to draw (optional, 0 if not specified)
+     * @param width Amount of columns to draw (optional, entire buffer if not specified), nothing is drawn if srcX is past
+     * the end of the buffer
+     * @param x Horizontal offset (optional, will display at 0, 0 if not specified)
+     * @param y Vertical offset (see x)
+     */
+    void drawBands(const MobiDOTBands &bands, int x = 0, int y = 0);
+    void drawBands(const MobiDOTBands &bands, uint srcX, uint width, int x, int y);
+
+    /**
+     * drawBandsChanged function
+     * Draws only the columns of a window of a band packed buffer that differ from what is currently displayed.
+     * Changed columns close to each other are sent as one segment, since every segment costs MOBIDOT_SEGMENT_HEADER bytes
+     * @param bands Band packed buffer
+     * @param srcX First column of the buffer to draw
+     * @param previous Buffer holding what is currently displayed, may be the same buffer as bands
+     * @param previousX First column of the currently displayed window in previous
+     * @param width Amount of columns to draw, nothing is drawn if srcX or previousX is past the end of its buffer
+     * @param x Horizontal offset
+     * @param y Vertical offset
+     */
+    void drawBandsChanged(const MobiDOTBands &bands, uint srcX, const MobiDOTBands &previous, uint previousX, uint width, int x, int y);
+
+    /**
+     * sendBands and sendBandsChanged functions
+     * Queue a frame holding just a window of a band packed buffer, like drawBands() or drawBandsChanged() followed by
+     * update(). The frame is encoded on its own, so the current display buffer and the selected display are left
+     * untouched and a frame being drawn elsewhere never gets mixed up with it. Widgets are not drawn
+     * @param type Display to send to
+     * @param priority Priority of the frame (optional, NORMAL if not specified)
+     * See drawBands() and drawBandsChanged() for the other parameters
+     * @returns True if the frame was queued, false if nothing changed, the window is past the end of a buffer or it
+     * was not queued
+     */
+    bool sendBands(MobiDOT::Display type, const MobiDOTBands &bands, uint srcX, uint width, int x, int y,
+                   MobiDOT::Priority priority = MobiDOT::Priority::NORMAL);
+    bool sendBandsChanged(MobiDOT::Display type, const MobiDOTBands &bands, uint srcX, const MobiDOTBands &previous,
+                          uint previousX, uint width, int x, int y, MobiDOT::Priority priority = MobiDOT::Priority::NORMAL);
+
+    /**
+     * drawCanvas function
+     * Packs a canvas into the band layout and draws it at 0, 0 of the currently selected display.
+     * Compose all layers on the canvas first, so the frame is encoded only once
+     * @param canvas Canvas to draw
+     * @param changed Only send the columns that differ from getFramebuffer() (optional, false if not specified).
+     * The framebuffer is only updated once a frame is sent, so only use this while isBusy() is false
+     */
+    void drawCanvas(const MobiDOTCanvas &canvas, bool changed = false);
+
+    /**
+     * getThroughput function
+     * Returns the measured speed of the RS485 bus, based on the time it took to send previous frames
+     * @returns Bytes per second
+     */
+    uint32_t getThroughput();
+
     /**
      * drawRect function
      * Draws a rectangle with the supplied width and height at the given coordinates
@@ -209,6 +520,50 @@ private:
     int8_t PIN_LIGHT = -1;
     bool STATE_LIGHT = false;
 
+    // Measured bus speed in bytes per second, see getThroughput()
+    uint32_t THROUGHPUT = RS485_BAUDRATE / 10;
+
+    /**
+     * @struct Frame
+     * Frame waiting for or being sent over the bus
+     */
+    struct Frame
+    {
+        char *data = nullptr;
+        uint size = 0;
+        unsigned long queued = 0; // micros() when queued, to measure latency
+    };
+
+    // Queued frames, one per priority and display
+    Frame QUEUE[MOBIDOT_PRIORITY_COUNT][MOBIDOT_DISPLAY_COUNT];
+
+    // Frame being sent, data is nullptr if the bus is idle
+    Frame ACTIVE;
+    MobiDOT::Priority ACTIVE_PRIORITY = MobiDOT::Priority::NORMAL;
+    MobiDOT::Display ACTIVE_DISPLAY = MobiDOT::Display::FRONT;
+    uint ACTIVE_POSITION = 0;
+    unsigned long ACTIVE_TIME = 0; // micros() spent writing the active frame, to measure throughput
+
+    // Content of every display according to the frames sent, see getFramebuffer()
+    MobiDOTBands *FRAMEBUFFER[MOBIDOT_DISPLAY_COUNT];
+    uint32_t FRAME_VERSION[MOBIDOT_DISPLAY_COUNT] = {0};
+    uint8_t FRAME_CHANGED[MOBIDOT_DISPLAY_COUNT] = {0};
+
+    // Frame counters, see getSentFrames(), getCoalescedFrames() and getDroppedFrames()
+    uint32_t SENT_FRAMES = 0;
+    uint32_t COALESCED_FRAMES = 0;
+    uint32_t DROPPED_FRAMES = 0;
+
+    // Last and highest latency per priority in milliseconds, see getLatency()
+    uint32_t LATENCY[MOBIDOT_PRIORITY_COUNT] = {0};
+    uint32_t LATENCY_MAX[MOBIDOT_PRIORITY_COUNT] = {0};
+
+    // Called after every frame that was sent successfully, see onFrame()
+    FrameCallback FRAME_CALLBACK = nullptr;
+
+    // Retained widgets per display, see addWidget()
+    MobiDOTWidget *WIDGETS[MOBIDOT_DISPLAY_COUNT][MOBIDOT_WIDGET_COUNT] = {{nullptr}};
+
     /**
      * @struct DisplayAttribute
      * Contains information about the displays defined in Display
@@ -225,7 +580,7 @@ private:
      * display array
      * Contains the compiler macros at the top of mobidot.hpp for easy access using Display
      */
-    const struct DisplayAttribute display[3] = {
+    const struct DisplayAttribute display[MOBIDOT_DISPLAY_COUNT] = {
         {
             MOBIDOT_ADDRESS_FRONT,
             MobiDOT::Font::TEXT_16PX_BOLD,
@@ -255,6 +610,54 @@ private:
      */
     void addHeader(MobiDOT::Display type, char data[], uint &size);
 
+    /**
+     * beginFrame function
+     * Adds the MobiDOT header for the selected display if the command buffer is still empty
+     */
+    void beginFrame();
+
+    /**
+     * addWidgets function
+     * Adds the output of all widgets of a display to the command buffer.
+     * Widgets that are dirty are rendered and their output is cached, clean widgets copy their cached output
+     * @param type Display type, see Display
+     */
+    void addWidgets(MobiDOT::Display type);
+
+    /**
+     * addSegment function
+     * Adds a BITWISE segment to a frame, the segment is dropped if it does not fit in RS485_BUFFER_SIZE
+     * @param data Frame data array
+     * @param size Size of the frame data so far
+     * @param x Horizontal offset
+     * @param y Vertical offset of the top row of the segment
+     * @param columns Column bytes in BITWISE format
+     * @param length Amount of columns
+     */
+    void addSegment(char data[], uint &size, int x, int y, const uint8_t columns[], uint length);
+
+    /**
+     * addBands and addBandsChanged functions
+     * Add the segments of drawBands() and drawBandsChanged() to a frame
+     * @param data Frame data array
+     * @param size Size of the frame data so far
+     * See drawBands() and drawBandsChanged() for the other parameters
+     */
+    void addBands(char data[], uint &size, const MobiDOTBands &bands, uint srcX, uint width, int x, int y);
+    void addBandsChanged(char data[], uint &size, const MobiDOTBands &bands, uint srcX, const MobiDOTBands &previous,
+                         uint previousX, uint width, int x, int y);
+
+    /**
+     * sendSegments function
+     * Finishes a frame built by sendBands() or sendBandsChanged() and queues it
+     * @param type Display the frame is addressed to
+     * @param data Frame data array holding the header and segments, deleted
+     * @param size Size of the frame data
+     * @param priority Frame priority
+     * @returns True if queued, false if the frame holds no segment or was not queued
+     */
+    bool sendSegments(MobiDOT::Display type, char data[], uint size, MobiDOT::Priority priority);
+
     /**
      * addFooter function
      * Adds MobiDOT footer to input data
@@ -263,12 +666,75 @@ private:
      */
     void addFooter(char data[], uint &size);
 
+    /**
+     * findDisplay function
+     * Looks up the display type belonging to a bus address
+     * @param address Address as used in the MobiDOT header
+     * @param type Set to the display type if found
+     * @returns True if the address belongs to one of the displays in Display
+     */
+    bool findDisplay(char address, MobiDOT::Display &type);
+
     /**
      * sendBuffer function
-     * Sends input data to display over the RS485 bus
+     * Copies input data into the transmit queue, the data is sent over the RS485 bus in loop()
+     * @param type Display the data is addressed to, passed to the frame callback
      * @param data Input data array
      * @param size Size of input data array
-     * @returns True if transfer successfull, false if not
+     * @param priority Frame priority
+     * @returns True if queued, false if not
+     */
+    bool sendBuffer(MobiDOT::Display type, const char data[], uint size, MobiDOT::Priority priority);
+
+    /**
+     * coversDisplay function
+     * Checks whether a frame sets every pixel of its display, so nothing sent before it stays visible.
+     * Only BITWISE segments starting at the left edge of a band count, anything else is assumed to be partial
+     * @param type Display the frame is addressed to
+     * @param data Frame data
+     * @param size Size of the frame data
+     * @returns True if the frame covers the entire display
+     */
+    bool coversDisplay(MobiDOT::Display type, const char data[], uint size);
+
+    /**
+     * mergeFrame function
+     * Appends everything between the header and footer of a frame to another frame for the same display
+     * @param frame Frame to append to, its data is replaced
+     * @param data Frame data to append
+     * @param size Size of the frame data
+     * @returns True if appended, false if the headers differ or the result would not fit in RS485_BUFFER_SIZE
+     */
+    bool mergeFrame(Frame &frame, const char data[], uint size);
+
+    /**
+     * findFooter function
+     * @param data Frame data
+     * @param size Size of the frame data
+     * @returns Position of the checksum in a complete frame
      */
-    bool sendBuffer(char data[], uint size);
-};
\ No newline at end of file
+    uint findFooter(const char data[], uint size);
+
+    /**
+     * applyFrame function
+     * Applies the BITWISE segments of a sent frame to the framebuffer of its display
+     * @param type Display the frame was sent to
+     * @param data Frame data
+     * @param size Size of the frame data
+     */
+    void applyFrame(MobiDOT::Display type, const char data[], uint size);
+
+    /**
+     * abortFrame function
+     * Ends the active frame with a wrong checksum so the display discards it and queues it again if possible
+     */
+    void abortFrame();
+
+    /**
+     * finishFrame function
+     * Releases the bus after the active frame was sent completely, measures latency and throughput
+     */
+    void finishFrame();
+};
+
+#endif // _MOBIDOT_HPP_
@@ -0,0 +1,174 @@
+/**
+ * @file scheduler.cpp
+ * Content scheduler for the MobiDOT display library
+ *
+ * Copyright (c) 2021 Arne van Iterson
+ */
+
+#include "./scheduler.hpp"
+#include "./trace.hpp"
+
+MobiDOTScheduler::MobiDOTScheduler(MobiDOT &mobidot, uint lead, MobiDOT::Priority priority)
+{
+    this->MOBIDOT = &mobidot;
+    this->LEAD = lead;
+    this->PRIORITY = priority;
+}
+
+MobiDOTScheduler::~MobiDOTScheduler()
+{
+    for (uint i = 0; i < MOBIDOT_DISPLAY_COUNT; i++)
+    {
+        delete[] this->TIMETABLES[i].next;
+    }
+}
+
+bool MobiDOTScheduler::addSlot(MobiDOT::Display type, uint duration, MobiDOTScheduler::RenderCallback render)
+{
+    Timetable &timetable = this->TIMETABLES[(uint)type];
+    if (timetable.count >= MOBIDOT_SCHEDULER_SLOTS)
+    {
+        return false;
+    }
+
+    timetable.slots[timetable.count].duration = duration;
+    timetable.slots[timetable.count].render = render;
+    timetable.count++;
+
+    // The slot after the current one may have changed
+    this->invalidate(type);
+    return true;
+}
+
+void MobiDOTScheduler::clearSlots(MobiDOT::Display type)
+{
+    Timetable &timetable = this->TIMETABLES[(uint)type];
+    for (uint i = 0; i < timetable.count; i++)
+    {
+        timetable.slots[i].render = nullptr;
+    }
+    timetable.count = 0;
+    timetable.current = -1;
+
+    this->invalidate(type);
+}
+
+void MobiDOTScheduler::invalidate(MobiDOT::Display type)
+{
+    Timetable &timetable = this->TIMETABLES[(uint)type];
+    delete[] timetable.next;
+    timetable.next = nullptr;
+    timetable.nextSize = 0;
+    timetable.ready = false;
+}
+
+bool MobiDOTScheduler::loop()
+{
+    const unsigned long now = millis();
+    bool switched = false;
+
+    // Switch every display of which the slot ended
+    for (uint i = 0; i < MOBIDOT_DISPLAY_COUNT; i++)
+    {
+        Timetable &timetable = this->TIMETABLES[i];
+        if (timetable.count == 0)
+        {
+            continue;
+        }
+
+        const bool started = timetable.current >= 0;
+        if (started && now - timetable.switched < timetable.slots[timetable.current].duration)
+        {
+            continue;
+        }
+
+        MOBIDOT_TRACE_SCOPE("schedule");
+        const MobiDOT::Display type = (MobiDOT::Display)i;
+        const uint slot = (started) ? (timetable.current + 1) % timetable.count : 0;
+
+        char *data = timetable.next;
+        uint size = timetable.nextSize;
+        const bool ready = timetable.ready;
+        timetable.next = nullptr;
+        timetable.nextSize = 0;
+        timetable.ready = false;
+
+        if (ready)
+        {
+            this->PRERENDERED++;
+        }
+        else
+        {
+            // Not rendered ahead of time, e.g. the first slot or a slot that was invalidated
+            data = this->render(type, slot, size);
+        }
+
+        if (data != nullptr)
+        {
+            this->MOBIDOT->send(data, size, this->PRIORITY);
+            delete[] data;
+        }
+
+        // Keep the timetable in step, unless we are so late that a whole slot was missed
+        if (started && now - timetable.switched < 2 * timetable.slots[timetable.current].duration)
+        {
+            timetable.switched += timetable.slots[timetable.current].duration;
+        }
+        else
+        {
+            timetable.switched = now;
+        }
+        timetable.current = slot;
+        switched = true;
+    }
+
+    if (switched)
+    {
+        return true;
+    }
+
+    // Nothing was due, render the next slot of one display while there is time
+    for (uint i = 0; i < MOBIDOT_DISPLAY_COUNT; i++)
+    {
+        Timetable &timetable = this->TIMETABLES[i];
+        if (timetable.count == 0 || timetable.current < 0 || timetable.ready)
+        {
+            continue;
+        }
+
+        const uint duration = timetable.slots[timetable.current].duration;
+        if (now - timetable.switched + this->LEAD < duration)
+        {
+            continue;
+        }
+
+        MOBIDOT_TRACE_SCOPE("prerender");
+        const uint slot = (timetable.current + 1) % timetable.count;
+        timetable.next = this->render((MobiDOT::Display)i, slot, timetable.nextSize);
+        timetable.ready = true;
+
+        // One display per call, so loop() does not hold up the bus for long
+        break;
+    }
+
+    return false;
+}
+
+int MobiDOTScheduler::getSlot(MobiDOT::Display type)
+{
+    return this->TIMETABLES[(uint)type].current;
+}
+
+uint32_t MobiDOTScheduler::getPrerendered()
+{
+    return this->PRERENDERED;
+}
+
+char *MobiDOTScheduler::render(MobiDOT::Display type, uint slot, uint &size)
+{
+    char *data = nullptr;
+    this->MOBIDOT->selectDisplay(type);
+    this->TIMETABLES[(uint)type].slots[slot].render(*this->MOBIDOT);
+    size = this->MOBIDOT->encode(data);
+    return data;
+}
@@ -0,0 +1,150 @@
+/**
+ * @file scheduler.hpp
+ * Content scheduler for the MobiDOT display library
+ *
+ * Every display gets a timetable of slots that are shown one after the other, e.g. destination, route and time.
+ * The frame of the next slot is rendered and encoded ahead of time, while nothing else is due, so switching slots
+ * only queues a finished frame and the switch costs nothing but bus time.
+ *
+ * Usage:
+ *   MobiDOTScheduler scheduler(MobiDOT);
+ *   scheduler.addSlot(MobiDOT::Display::FRONT, 5000, [](MobiDOT &display) { display.print("12 Centraal", ...); });
+ *   scheduler.addSlot(MobiDOT::Display::FRONT, 2000, [](MobiDOT &display) { display.drawBitmap(...); });
+ *   // In loop(), after MobiDOT.loop()
+ *   scheduler.loop();
+ *
+ * Copyright (c) 2021 Arne van Iterson
+ */
+
+#ifndef _MOBIDOT_SCHEDULER_HPP_
+#define _MOBIDOT_SCHEDULER_HPP_
+
+#include <functional>
+#include "./mobidot.hpp"
+
+/* Maximum amount of slots per display */
+#define MOBIDOT_SCHEDULER_SLOTS 8
+
+/**
+ * @class MobiDOTScheduler class
+ */
+class MobiDOTScheduler
+{
+public:
+    /**
+     * RenderCallback type
+     * Draws the content of a slot, the display of the slot is selected already. Do not call update().
+     * The slot may be rendered before the previous slot is shown, so draw the complete content and do not use
+     * drawBandsChanged()
+     * @param mobidot Display controller to draw with
+     */
+    typedef std::function<void(MobiDOT &mobidot)> RenderCallback;
+
+    /**
+     * MobiDOTScheduler class constructor
+     * @param mobidot Display controller to send the frames with
+     * @param lead How long before a switch the next slot is rendered in milliseconds (optional, 1 second if not specified).
+     * Slots showing changing content like the time are rendered at most this long before they are shown
+     * @param priority Priority of the frames (optional, NORMAL if not specified)
+     */
+    MobiDOTScheduler(MobiDOT &mobidot, uint lead = 1000, MobiDOT::Priority priority = MobiDOT::Priority::NORMAL);
+
+    /**
+     * MobiDOTScheduler class deconstructor
+     */
+    ~MobiDOTScheduler();
+
+    MobiDOTScheduler(const MobiDOTScheduler &) = delete;
+    MobiDOTScheduler &operator=(const MobiDOTScheduler &) = delete;
+
+    /**
+     * addSlot function
+     * Adds a slot to the end of the timetable of a display, the first slot of a display is shown on the next loop()
+     * @param type MobiDOT::Display type
+     * @param duration Time the slot is shown in milliseconds
+     * @param render Draws the content of the slot
+     * @returns True if the slot was added, false if the display already has MOBIDOT_SCHEDULER_SLOTS slots
+     */
+    bool addSlot(MobiDOT::Display type, uint duration, RenderCallback render);
+
+    /**
+     * clearSlots function
+     * Removes all slots of a display, the display keeps showing the last slot
+     * @param type MobiDOT::Display type
+     */
+    void clearSlots(MobiDOT::Display type);
+
+    /**
+     * invalidate function
+     * Drops the frame rendered ahead of time for a display, call this when the content of its next slot changed
+     * @param type MobiDOT::Display type
+     */
+    void invalidate(MobiDOT::Display type);
+
+    /**
+     * loop function
+     * Switches slots that are due and renders the next slot of one display ahead of time if nothing was due,
+     * call this from loop() after MobiDOT::loop() and not in between drawing and update(), slots are drawn in the same buffer.
+     * Selects the display of a slot when rendering it
+     * @returns True if a slot was switched
+     */
+    bool loop();
+
+    /**
+     * getSlot function
+     * @param type MobiDOT::Display type
+     * @returns Index of the slot that is shown, -1 if nothing was shown yet
+     */
+    int getSlot(MobiDOT::Display type);
+
+    /**
+     * getPrerendered function
+     * @returns Amount of switches that sent a frame rendered ahead of time, the other switches had to render on the spot
+     */
+    uint32_t getPrerendered();
+
+private:
+    MobiDOT *MOBIDOT;
+    uint LEAD;
+    MobiDOT::Priority PRIORITY;
+
+    /**
+     * @struct Slot
+     * Entry of a timetable
+     */
+    struct Slot
+    {
+        uint duration;
+        RenderCallback render;
+    };
+
+    /**
+     * @struct Timetable
+     * Slots of a display and the frame of the next slot
+     */
+    struct Timetable
+    {
+        Slot slots[MOBIDOT_SCHEDULER_SLOTS];
+        uint count = 0;
+
+        int current = -1; // Slot shown, -1 if nothing was shown yet
+        unsigned long switched = 0;
+
+        char *next = nullptr; // Frame of the slot after current, nullptr if the slot did not draw anything
+        uint nextSize = 0;
+        bool ready = false; // The slot after current was rendered ahead of time
+    };
+
+    Timetable TIMETABLES[MOBIDOT_DISPLAY_COUNT];
+    uint32_t PRERENDERED = 0;
+
+    /**
+     * render function
+     * Renders and encodes a slot
+     * @param size Set to the size of the frame
+     * @returns New buffer holding the frame, nullptr if the slot did not draw anything
+     */
+    char *render(MobiDOT::Display type, uint slot, uint &size);
+};
+
+#endif // _MOBIDOT_SCHEDULER_HPP_
@@ -0,0 +1,119 @@
+/**
+ * @file trace.cpp
+ * Event tracing for the MobiDOT display library
+ *
+ * Copyright (c) 2021 Arne van Iterson
+ */
+
+#include "./trace.hpp"
+
+#ifdef MOBIDOT_TRACE
+
+static MobiDOTTraceEvent traceEvents[MOBIDOT_TRACE_SIZE];
+static uint traceHead = 0;  // Index the next event is written to
+static uint traceCount = 0; // Amount of valid events
+static uint32_t traceOverwritten = 0;
+
+void MobiDOTTrace::record(const char *name, char phase, MobiDOTTrace::Track track)
+{
+    MobiDOTTraceEvent &event = traceEvents[traceHead];
+    event.name = name;
+    event.time = micros();
+    event.phase = phase;
+    event.track = track;
+
+    traceHead = (traceHead + 1) % MOBIDOT_TRACE_SIZE;
+    if (traceCount < MOBIDOT_TRACE_SIZE)
+    {
+        traceCount++;
+    }
+    else
+    {
+        traceOverwritten++;
+    }
+}
+
+uint MobiDOTTrace::snapshot(MobiDOTTraceEvent events[], uint size)
+{
+    const uint count = min(size, traceCount);
+
+    // Oldest event first, that is the one at the head once the buffer wrapped around
+    const uint first = (traceHead + MOBIDOT_TRACE_SIZE - traceCount) % MOBIDOT_TRACE_SIZE;
+    for (uint i = 0; i < count; i++)
+    {
+        events[i] = traceEvents[(first + traceCount - count + i) % MOBIDOT_TRACE_SIZE];
+    }
+    return count;
+}
+
+uint32_t MobiDOTTrace::getOverwritten()
+{
+    return traceOverwritten;
+}
+
+void MobiDOTTrace::clear()
+{
+    traceHead = 0;
+    traceCount = 0;
+    traceOverwritten = 0;
+}
+
+MobiDOTTraceExport::MobiDOTTraceExport()
+{
+    this->COUNT = MobiDOTTrace::snapshot(this->EVENTS, MOBIDOT_TRACE_SIZE);
+}
+
+size_t MobiDOTTraceExport::read(uint8_t *buffer, size_t size)
+{
+    size_t written = 0;
+    while (written < size)
+    {
+        if (this->PENDING_POSITION >= this->PENDING_SIZE && !this->next())
+        {
+            break;
+        }
+
+        const size_t length = min(size - written, this->PENDING_SIZE - this->PENDING_POSITION);
+        memcpy(buffer + written, this->PENDING + this->PENDING_POSITION, length);
+        this->PENDING_POSITION += length;
+        written += length;
+    }
+    return written;
+}
+
+bool MobiDOTTraceExport::next()
+{
+    const uint part = this->PART++;
+    int length;
+
+    if (part < 2)
+    {
+        // Name the tracks, the metadata events are not recorded so they can not be overwritten
+        length = snprintf(this->PENDING, sizeof(this->PENDING),
+                          "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                          (part == 0) ? "{\"traceEvents\":[\n" : ",\n",
+                          (part == 0) ? MobiDOTTrace::CPU : MobiDOTTrace::BUS,
+                          (part == 0) ? "CPU" : "BUS");
+    }
+    else if (part < this->COUNT + 2)
+    {
+        const MobiDOTTraceEvent &event = this->EVENTS[part - 2];
+        length = snprintf(this->PENDING, sizeof(this->PENDING),
+                          ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%u,\"pid\":1,\"tid\":%u%s}",
+                          event.name, event.phase, event.time, event.track, (event.phase == 'i') ? ",\"s\":\"t\"" : "");
+    }
+    else if (part == this->COUNT + 2)
+    {
+        length = snprintf(this->PENDING, sizeof(this->PENDING), "\n],\"displayTimeUnit\":\"ms\"}\n");
+    }
+    else
+    {
+        return false;
+    }
+
+    this->PENDING_SIZE = min((size_t)max(length, 0), sizeof(this->PENDING) - 1);
+    this->PENDING_POSITION = 0;
+    return true;
+}
+
+#endif // MOBIDOT_TRACE
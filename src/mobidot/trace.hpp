@@ -0,0 +1,164 @@
+/**
+ * @file trace.hpp
+ * Event tracing for the MobiDOT display library
+ *
+ * Trace points record timestamped begin and end events into a fixed size ring buffer in RAM, the oldest events are
+ * overwritten. The buffer can be exported as Chrome trace JSON, which opens in about:tracing and ui.perfetto.dev.
+ * Events are recorded on two tracks: CPU for work done in loop() and request handlers, BUS for frames on the RS485 bus.
+ *
+ * Tracing is disabled unless MOBIDOT_TRACE is defined (add -D MOBIDOT_TRACE to the build flags), the macros then
+ * expand to nothing and none of this is compiled in.
+ *
+ * Copyright (c) 2021 Arne van Iterson
+ */
+
+#ifndef _MOBIDOT_TRACE_HPP_
+#define _MOBIDOT_TRACE_HPP_
+
+#ifdef MOBIDOT_TRACE
+
+#include <Arduino.h>
+
+/* Amount of events kept, every event takes 12 bytes of RAM */
+#ifndef MOBIDOT_TRACE_SIZE
+#define MOBIDOT_TRACE_SIZE 256
+#endif
+
+/**
+ * @struct MobiDOTTraceEvent
+ * Single recorded event
+ */
+struct MobiDOTTraceEvent
+{
+    const char *name; // Only the pointer is stored, names have to be string literals
+    uint32_t time;    // micros() when recorded
+    char phase;       // B(egin), E(nd) or i(nstant) like in the Chrome trace format
+    uint8_t track;
+};
+
+/**
+ * @class MobiDOTTrace class
+ * Ring buffer the trace points record into
+ */
+class MobiDOTTrace
+{
+public:
+    /**
+     * @enum Track
+     * Tracks show up as threads in the trace viewer, events on a track have to nest properly
+     */
+    enum Track : uint8_t
+    {
+        CPU = 1,
+        BUS = 2
+    };
+
+    /**
+     * record function
+     * Records an event, use the MOBIDOT_TRACE macros instead so they compile out
+     * @param name Name of the event, a string literal
+     * @param phase B, E or i
+     * @param track Track to record on
+     */
+    static void record(const char *name, char phase, MobiDOTTrace::Track track);
+
+    /**
+     * snapshot function
+     * Copies the recorded events, oldest first
+     * @param events Array to copy to
+     * @param size Size of the array
+     * @returns Amount of events copied
+     */
+    static uint snapshot(MobiDOTTraceEvent events[], uint size);
+
+    /**
+     * getOverwritten function
+     * @returns Amount of events lost because the ring buffer was full
+     */
+    static uint32_t getOverwritten();
+
+    /**
+     * clear function
+     * Removes all recorded events
+     */
+    static void clear();
+};
+
+/**
+ * @class MobiDOTTraceScope class
+ * Records a begin event on construction and the end event when it goes out of scope
+ */
+class MobiDOTTraceScope
+{
+public:
+    MobiDOTTraceScope(const char *name, MobiDOTTrace::Track track = MobiDOTTrace::CPU) : NAME(name), TRACK(track)
+    {
+        MobiDOTTrace::record(name, 'B', track);
+    }
+
+    ~MobiDOTTraceScope()
+    {
+        MobiDOTTrace::record(this->NAME, 'E', this->TRACK);
+    }
+
+private:
+    const char *NAME;
+    MobiDOTTrace::Track TRACK;
+};
+
+/**
+ * @class MobiDOTTraceExport class
+ * Formats a snapshot of the ring buffer as Chrome trace JSON, in pieces of any size so it can be sent as a chunked response
+ */
+class MobiDOTTraceExport
+{
+public:
+    /**
+     * MobiDOTTraceExport class constructor
+     * Takes the snapshot, events recorded afterwards are not exported
+     */
+    MobiDOTTraceExport();
+
+    /**
+     * read function
+     * @param buffer Buffer to write the next piece of JSON to
+     * @param size Size of the buffer
+     * @returns Amount of bytes written, 0 once everything was read
+     */
+    size_t read(uint8_t *buffer, size_t size);
+
+private:
+    MobiDOTTraceEvent EVENTS[MOBIDOT_TRACE_SIZE];
+    uint COUNT;
+
+    // Next part to format: the header with two track names, every event and then the footer
+    uint PART = 0;
+
+    // Formatted part that did not fit in the last buffer
+    char PENDING[128];
+    size_t PENDING_SIZE = 0;
+    size_t PENDING_POSITION = 0;
+
+    /**
+     * next function
+     * Formats the next part into PENDING
+     * @returns False if there is nothing left
+     */
+    bool next();
+};
+
+#define MOBIDOT_TRACE_SCOPE(name) MobiDOTTraceScope _mobidotTraceScope(name)
+#define MOBIDOT_TRACE_BEGIN(name, track) MobiDOTTrace::record(name, 'B', MobiDOTTrace::track)
+#define MOBIDOT_TRACE_END(name, track) MobiDOTTrace::record(name, 'E', MobiDOTTrace::track)
+#define MOBIDOT_TRACE_INSTANT(name, track) MobiDOTTrace::record(name, 'i', MobiDOTTrace::track)
+
+#else
+
+#define MOBIDOT_TRACE_SCOPE(name)
+#define MOBIDOT_TRACE_BEGIN(name, track)
+#define MOBIDOT_TRACE_END(name, track)
+#define MOBIDOT_TRACE_INSTANT(name, track)
+
+#endif // MOBIDOT_TRACE
+
+#endif // _MOBIDOT_TRACE_HPP_
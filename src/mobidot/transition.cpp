@@ -0,0 +1,231 @@
+/**
+ * @file transition.cpp
+ * Transition effects for the MobiDOT display library
+ *
+ * Copyright (c) 2021 Arne van Iterson
+ */
+
+#include "./transition.hpp"
+
+/**
+ * Copies the overlapping area of two band packed buffers
+ */
+static void copyBands(MobiDOTBands &destination, const MobiDOTBands &source)
+{
+    const uint width = min(destination.getWidth(), source.getWidth());
+    const uint count = min(destination.getBands(), source.getBands());
+
+    for (uint i = 0; i < count; i++)
+    {
+        memcpy(destination.getBand(i), source.getBand(i), width);
+    }
+}
+
+MobiDOTTransition::MobiDOTTransition(MobiDOT &mobidot, MobiDOT::Display type, MobiDOTTransition::Effect effect, uint duration, uint interval)
+{
+    this->MOBIDOT = &mobidot;
+    this->TYPE = type;
+    this->EFFECT = effect;
+    this->DURATION = duration;
+    this->INTERVAL = interval;
+
+    const uint width = mobidot.getWidth(type);
+    const uint height = mobidot.getHeight(type);
+    this->FROM = new MobiDOTBands(width, height);
+    this->TO = new MobiDOTBands(width, height);
+    this->SHOWN = new MobiDOTBands(width, height);
+    this->STEP = new MobiDOTBands(width, height);
+}
+
+MobiDOTTransition::~MobiDOTTransition()
+{
+    delete this->FROM;
+    delete this->TO;
+    delete this->SHOWN;
+    delete this->STEP;
+}
+
+void MobiDOTTransition::start(const MobiDOTBands &next)
+{
+    copyBands(*this->TO, next);
+
+    this->RUNNING = true;
+    this->STARTED = false;
+    this->STEPS = 0;
+}
+
+void MobiDOTTransition::setEffect(MobiDOTTransition::Effect effect, uint duration)
+{
+    this->EFFECT = effect;
+    this->DURATION = duration;
+}
+
+bool MobiDOTTransition::loop()
+{
+    // Steps are only sent on an idle bus, every step depends on the previous one being shown
+    if (!this->RUNNING || this->MOBIDOT->isBusy())
+    {
+        return false;
+    }
+
+    MobiDOT *mobidot = this->MOBIDOT;
+
+    if (!this->STARTED)
+    {
+        // Nothing is in flight, so the framebuffer is what the display shows
+        copyBands(*this->FROM, mobidot->getFramebuffer(this->TYPE));
+        copyBands(*this->SHOWN, *this->FROM);
+        this->STARTED = true;
+        this->START = millis();
+    }
+    else if (millis() - this->LAST_STEP < this->INTERVAL)
+    {
+        return false;
+    }
+    this->LAST_STEP = millis();
+
+    const unsigned long elapsed = millis() - this->START;
+    const uint progress = (elapsed >= this->DURATION) ? MOBIDOT_TRANSITION_DONE : elapsed * MOBIDOT_TRANSITION_DONE / this->DURATION;
+    this->compose(progress);
+
+    // Early steps of slow effects may not change a single pixel, sending just a header would waste bus time
+    bool changed = false;
+    for (uint i = 0; i < this->STEP->getBands() && !changed; i++)
+    {
+        changed = memcmp(this->STEP->getBand(i), this->SHOWN->getBand(i), this->STEP->getWidth()) != 0;
+    }
+    if (!changed)
+    {
+        this->RUNNING = progress < MOBIDOT_TRANSITION_DONE;
+        return false;
+    }
+
+    // SHOWN has to stay what the sign shows, if the step was not queued the next call sends its changes again
+    if (!mobidot->sendBandsChanged(this->TYPE, *this->STEP, 0, *this->SHOWN, 0, this->STEP->getWidth(), 0, 0))
+    {
+        return false;
+    }
+
+    MobiDOTBands *shown = this->SHOWN;
+    this->SHOWN = this->STEP;
+    this->STEP = shown;
+
+    this->STEPS++;
+    this->RUNNING = progress < MOBIDOT_TRANSITION_DONE;
+    return true;
+}
+
+bool MobiDOTTransition::isRunning()
+{
+    return this->RUNNING;
+}
+
+uint MobiDOTTransition::getSteps()
+{
+    return this->STEPS;
+}
+
+void MobiDOTTransition::compose(uint progress)
+{
+    const uint width = this->STEP->getWidth();
+    const uint height = this->STEP->getHeight();
+
+    for (uint i = 0; i < this->STEP->getBands(); i++)
+    {
+        const uint8_t *from = this->FROM->getBand(i);
+        const uint8_t *to = this->TO->getBand(i);
+        uint8_t *step = this->STEP->getBand(i);
+        const uint top = i * MOBIDOT_BAND_HEIGHT;
+
+        switch (this->EFFECT)
+        {
+        case WIPE_LEFT:
+        case WIPE_RIGHT:
+        {
+            // Columns past the edge show the next content
+            const uint edge = width * progress / MOBIDOT_TRANSITION_DONE;
+            for (uint x = 0; x < width; x++)
+            {
+                const bool next = (this->EFFECT == WIPE_RIGHT) ? x < edge : x >= width - edge;
+                step[x] = (next) ? to[x] : from[x];
+            }
+            break;
+        }
+
+        case WIPE_UP:
+        case WIPE_DOWN:
+        {
+            // Rows past the edge show the next content, within a band these are the low or high bits
+            const uint edge = height * progress / MOBIDOT_TRANSITION_DONE;
+            uint8_t mask;
+            if (this->EFFECT == WIPE_DOWN)
+            {
+                const uint rows = (edge > top) ? min(edge - top, (uint)MOBIDOT_BAND_HEIGHT) : 0;
+                mask = (1 << rows) - 1;
+            }
+            else
+            {
+                const uint start = height - edge;
+                const uint rows = (start > top) ? min(start - top, (uint)MOBIDOT_BAND_HEIGHT) : 0;
+                mask = MOBIDOT_BAND_MASK & ~((1 << rows) - 1);
+            }
+
+            for (uint x = 0; x < width; x++)
+            {
+                step[x] = (to[x] & mask) | (from[x] & ~mask);
+            }
+            break;
+        }
+
+        case SLIDE_LEFT:
+        case SLIDE_RIGHT:
+        {
+            // Both buffers side by side form a strip of twice the width, the window moves over it
+            const uint offset = width * progress / MOBIDOT_TRANSITION_DONE;
+            for (uint x = 0; x < width; x++)
+            {
+                if (this->EFFECT == SLIDE_LEFT)
+                {
+                    step[x] = (x + offset < width) ? from[x + offset] : to[x + offset - width];
+                }
+                else
+                {
+                    step[x] = (x >= offset) ? from[x - offset] : to[width - offset + x];
+                }
+            }
+            break;
+        }
+
+        case DISSOLVE:
+        {
+            for (uint x = 0; x < width; x++)
+            {
+                uint8_t mask = 0;
+                for (uint k = 0; k < MOBIDOT_BAND_HEIGHT; k++)
+                {
+                    if (threshold(x, top + k) < progress)
+                    {
+                        mask |= 1 << k;
+                    }
+                }
+                step[x] = (to[x] & mask) | (from[x] & ~mask);
+            }
+            break;
+        }
+
+        default:
+            memcpy(step, to, width);
+            break;
+        }
+    }
+}
+
+uint8_t MobiDOTTransition::threshold(uint x, uint y)
+{
+    // Integer hash of the position, spreads the changing pixels evenly over the display
+    uint32_t hash = x * 0x9e3779b1 ^ y * 0x85ebca77;
+    hash ^= hash >> 15;
+    hash *= 0x2c1b3c6d;
+    hash ^= hash >> 12;
+    return hash >> 24;
+}
@@ -0,0 +1,133 @@
+/**
+ * @file transition.hpp
+ * Transition effects for the MobiDOT display library
+ *
+ * Changes the content of a display from what it shows to a new band packed buffer using a wipe, slide or dissolve.
+ * Every step is composed from both buffers in RAM and only the columns that differ from the previous step are sent,
+ * so a transition costs bus time for the pixels that change instead of full frames. A step is sent as soon as the bus
+ * is idle and shows the progress at that moment, a slow bus sends fewer steps instead of running late.
+ *
+ * Copyright (c) 2021 Arne van Iterson
+ */
+
+#ifndef _MOBIDOT_TRANSITION_HPP_
+#define _MOBIDOT_TRANSITION_HPP_
+
+#include "./mobidot.hpp"
+#include "./bands.hpp"
+
+/* Progress of a transition in fixed point, this is done */
+#define MOBIDOT_TRANSITION_DONE 256
+
+/**
+ * @class MobiDOTTransition class
+ */
+class MobiDOTTransition
+{
+public:
+    /**
+     * @enum Effect
+     * Ways to change from the current to the next content
+     */
+    enum Effect
+    {
+        CUT,         // Everything at once, only the changed columns are sent
+        WIPE_LEFT,   // Next content is revealed from the right to the left
+        WIPE_RIGHT,  // Next content is revealed from the left to the right
+        WIPE_UP,     // Next content is revealed from the bottom to the top
+        WIPE_DOWN,   // Next content is revealed from the top to the bottom
+        SLIDE_LEFT,  // Current content moves out to the left while the next content moves in from the right
+        SLIDE_RIGHT, // Current content moves out to the right while the next content moves in from the left
+        DISSOLVE     // Pixels change in a fixed pseudo random order
+    };
+
+    /**
+     * MobiDOTTransition class constructor
+     * Allocates the buffers for the display, nothing is sent until start() and loop() are called
+     * @param mobidot Display controller to send the steps with
+     * @param type Display to run transitions on
+     * @param effect Effect to use
+     * @param duration Time the transition takes in milliseconds (optional, 1 second if not specified)
+     * @param interval Minimum time between steps in milliseconds (optional, as fast as the bus allows if 0)
+     */
+    MobiDOTTransition(MobiDOT &mobidot, MobiDOT::Display type, MobiDOTTransition::Effect effect, uint duration = 1000, uint interval = 0);
+
+    /**
+     * MobiDOTTransition class deconstructor
+     */
+    ~MobiDOTTransition();
+
+    MobiDOTTransition(const MobiDOTTransition &) = delete;
+    MobiDOTTransition &operator=(const MobiDOTTransition &) = delete;
+
+    /**
+     * start function
+     * Starts a transition to new content, a running transition is replaced and continues from what was sent so far.
+     * The content is copied, the transition starts from MobiDOT::getFramebuffer() once the bus is idle
+     * @param next Band packed buffer with the new content, areas outside of the display are ignored
+     */
+    void start(const MobiDOTBands &next);
+
+    /**
+     * setEffect function
+     * @param effect Effect to use for the next start()
+     * @param duration Time the transition takes in milliseconds
+     */
+    void setEffect(MobiDOTTransition::Effect effect, uint duration);
+
+    /**
+     * loop function
+     * Queues the next step if the bus is idle, call this from loop() after MobiDOT::loop().
+     * Steps are encoded on their own, they leave the display buffer alone and do not include widgets
+     * @returns True if a step was queued
+     */
+    bool loop();
+
+    /**
+     * isRunning function
+     * @returns True until the last step was queued
+     */
+    bool isRunning();
+
+    /**
+     * getSteps function
+     * @returns Amount of steps queued by the current or last transition
+     */
+    uint getSteps();
+
+private:
+    MobiDOT *MOBIDOT;
+    MobiDOT::Display TYPE;
+    MobiDOTTransition::Effect EFFECT;
+    uint DURATION;
+    uint INTERVAL;
+
+    // Content before and after the transition
+    MobiDOTBands *FROM;
+    MobiDOTBands *TO;
+
+    // Last step sent and the step being composed, swapped after every step
+    MobiDOTBands *SHOWN;
+    MobiDOTBands *STEP;
+
+    bool RUNNING = false;
+    bool STARTED = false; // FROM holds the content the transition started from
+    uint STEPS = 0;
+    unsigned long START = 0;
+    unsigned long LAST_STEP = 0;
+
+    /**
+     * compose function
+     * Composes the step at the given progress into STEP
+     * @param progress 0 up to MOBIDOT_TRANSITION_DONE
+     */
+    void compose(uint progress);
+
+    /**
+     * threshold function
+     * @returns Progress at which a pixel changes while dissolving, the same for every transition
+     */
+    static uint8_t threshold(uint x, uint y);
+};
+
+#endif // _MOBIDOT_TRANSITION_HPP_
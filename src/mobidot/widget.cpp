@@ -0,0 +1,220 @@
+/**
+ * @file widget.cpp
+ * Retained mode widgets for the MobiDOT display library
+ *
+ * Copyright (c) 2021 Arne van Iterson
+ */
+
+#include "./widget.hpp"
+
+/**
+ * MobiDOTWidget
+ */
+
+MobiDOTWidget::MobiDOTWidget(int x, int y, uint width, uint height)
+{
+    this->X = x;
+    this->Y = y;
+    this->WIDTH = width;
+    this->HEIGHT = height;
+}
+
+MobiDOTWidget::~MobiDOTWidget()
+{
+    delete[] this->CACHE_DATA;
+}
+
+void MobiDOTWidget::invalidate()
+{
+    this->DIRTY = true;
+}
+
+bool MobiDOTWidget::isDirty()
+{
+    return this->DIRTY;
+}
+
+void MobiDOTWidget::move(int x, int y)
+{
+    if (x != this->X || y != this->Y)
+    {
+        this->X = x;
+        this->Y = y;
+        this->invalidate();
+    }
+}
+
+int MobiDOTWidget::getX()
+{
+    return this->X;
+}
+
+int MobiDOTWidget::getY()
+{
+    return this->Y;
+}
+
+uint MobiDOTWidget::getWidth()
+{
+    return this->WIDTH;
+}
+
+uint MobiDOTWidget::getHeight()
+{
+    return this->HEIGHT;
+}
+
+void MobiDOTWidget::draw(MobiDOT &display)
+{
+    // Clear whatever was drawn in the bounds before, e.g. a longer string
+    display.clearRect(this->WIDTH, this->HEIGHT, this->X, this->Y);
+    this->render(display);
+}
+
+/**
+ * MobiDOTTextWidget
+ */
+
+MobiDOTTextWidget::MobiDOTTextWidget(const char text[], MobiDOT::Font font, int x, int y, uint width, uint height)
+    : MobiDOTWidget(x, y, width, height)
+{
+    this->FONT = font;
+    this->setText(text);
+}
+
+MobiDOTTextWidget::MobiDOTTextWidget(const char text[], const GFXfont *font, int x, int y, uint width, uint height, bool invert)
+    : MobiDOTWidget(x, y, width, height)
+{
+    this->FONT_GFX = font;
+    this->INVERT = invert;
+    this->setText(text);
+}
+
+void MobiDOTTextWidget::setText(const char text[])
+{
+    // Nothing to do if the string did not change
+    if (strncmp(this->TEXT, text, sizeof(this->TEXT) - 1) == 0)
+    {
+        return;
+    }
+
+    strncpy(this->TEXT, text, sizeof(this->TEXT) - 1);
+    this->invalidate();
+}
+
+const char *MobiDOTTextWidget::getText()
+{
+    return this->TEXT;
+}
+
+void MobiDOTTextWidget::render(MobiDOT &display)
+{
+    if (this->FONT_GFX != nullptr)
+    {
+        display.print(this->TEXT, this->FONT_GFX, this->X, this->Y, this->INVERT);
+    }
+    else
+    {
+        display.print(this->TEXT, this->FONT, this->X, this->Y);
+    }
+}
+
+/**
+ * MobiDOTBitmapWidget
+ */
+
+MobiDOTBitmapWidget::MobiDOTBitmapWidget(const unsigned char data[], uint width, uint height, int x, int y, bool invert)
+    : MobiDOTWidget(x, y, width, height)
+{
+    this->DATA = data;
+    this->INVERT = invert;
+}
+
+void MobiDOTBitmapWidget::setBitmap(const unsigned char data[])
+{
+    this->DATA = data;
+    this->invalidate();
+}
+
+void MobiDOTBitmapWidget::render(MobiDOT &display)
+{
+    display.drawBitmap(this->DATA, this->WIDTH, this->HEIGHT, this->X, this->Y, this->INVERT);
+}
+
+/**
+ * MobiDOTClockWidget
+ */
+
+MobiDOTClockWidget::MobiDOTClockWidget(MobiDOT::Font font, int x, int y, uint width, uint height, bool seconds)
+    : MobiDOTTextWidget("", font, x, y, width, height)
+{
+    this->SECONDS = seconds;
+    this->setTime(0, 0, 0);
+}
+
+MobiDOTClockWidget::MobiDOTClockWidget(const GFXfont *font, int x, int y, uint width, uint height, bool seconds, bool invert)
+    : MobiDOTTextWidget("", font, x, y, width, height, invert)
+{
+    this->SECONDS = seconds;
+    this->setTime(0, 0, 0);
+}
+
+void MobiDOTClockWidget::setTime(uint8_t hours, uint8_t minutes, uint8_t seconds)
+{
+    char text[9];
+
+    if (this->SECONDS)
+    {
+        snprintf(text, sizeof(text), "%02u:%02u:%02u", hours % 24, minutes % 60, seconds % 60);
+    }
+    else
+    {
+        snprintf(text, sizeof(text), "%02u:%02u", hours % 24, minutes % 60);
+    }
+
+    // setText only invalidates the widget if the string changed
+    this->setText(text);
+}
+
+/**
+ * MobiDOTCounterWidget
+ */
+
+MobiDOTCounterWidget::MobiDOTCounterWidget(MobiDOT::Font font, int x, int y, uint width, uint height, uint8_t digits)
+    : MobiDOTTextWidget("0", font, x, y, width, height)
+{
+    this->DIGITS = min(digits, (uint8_t)MOBIDOT_COUNTER_DIGITS);
+
+    // Make sure the first setValue() formats the text with the requested amount of digits
+    this->VALUE = 1;
+    this->setValue(0);
+}
+
+MobiDOTCounterWidget::MobiDOTCounterWidget(const GFXfont *font, int x, int y, uint width, uint height, uint8_t digits, bool invert)
+    : MobiDOTTextWidget("0", font, x, y, width, height, invert)
+{
+    this->DIGITS = min(digits, (uint8_t)MOBIDOT_COUNTER_DIGITS);
+
+    // Make sure the first setValue() formats the text with the requested amount of digits
+    this->VALUE = 1;
+    this->setValue(0);
+}
+
+void MobiDOTCounterWidget::setValue(int32_t value)
+{
+    if (value == this->VALUE)
+    {
+        return;
+    }
+    this->VALUE = value;
+
+    // Sign and 10 digits of an int32_t fit, DIGITS is at most MOBIDOT_COUNTER_DIGITS
+    char text[12];
+    snprintf(text, sizeof(text), "%0*ld", min((int)this->DIGITS, MOBIDOT_COUNTER_DIGITS), (long)value);
+    this->setText(text);
+}
+
+int32_t MobiDOTCounterWidget::getValue()
+{
+    return this->VALUE;
+}
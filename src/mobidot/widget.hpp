@@ -0,0 +1,230 @@
+/**
+ * @file widget.hpp
+ * Retained mode widgets for the MobiDOT display library
+ *
+ * Widgets are added to a display using MobiDOT::addWidget() and are drawn on every update() of that display.
+ * Each widget keeps its own bounds and the commands it produced last time, only widgets that were invalidated
+ * are rendered again.
+ *
+ * Copyright (c) 2021 Arne van Iterson
+ */
+
+#ifndef _MOBIDOT_WIDGET_HPP_
+#define _MOBIDOT_WIDGET_HPP_
+
+#include "./mobidot.hpp"
+
+/* Widget constants */
+#define MOBIDOT_WIDGET_TEXT_SIZE 32
+#define MOBIDOT_COUNTER_DIGITS 10 // Most digits a counter pads to, enough for any int32_t
+
+/**
+ * @class MobiDOTWidget class
+ * Base class for all widgets
+ */
+class MobiDOTWidget
+{
+public:
+    /**
+     * MobiDOTWidget class constructor
+     * @param x Horizontal offset
+     * @param y Vertical offset
+     * @param width Width of the area the widget draws in
+     * @param height Height of the area the widget draws in
+     */
+    MobiDOTWidget(int x, int y, uint width, uint height);
+
+    /**
+     * MobiDOTWidget class deconstructor
+     * Frees the cached output, remove the widget from its display before destroying it
+     */
+    virtual ~MobiDOTWidget();
+
+    /**
+     * invalidate function
+     * Marks the widget as dirty, it will be rendered again on the next update of its display
+     */
+    void invalidate();
+
+    /**
+     * isDirty function
+     * @returns True if the widget will be rendered again on the next update
+     */
+    bool isDirty();
+
+    /**
+     * move function
+     * Moves the widget to a new position
+     * @param x Horizontal offset
+     * @param y Vertical offset
+     */
+    void move(int x, int y);
+
+    int getX();
+    int getY();
+    uint getWidth();
+    uint getHeight();
+
+protected:
+    // Bounds of the widget
+    int X;
+    int Y;
+    uint WIDTH;
+    uint HEIGHT;
+
+    /**
+     * render function
+     * Draws the widget using the drawing functions of the display.
+     * The bounds of the widget are cleared before this function is called.
+     * @param display Display to draw on, the correct display is already selected
+     */
+    virtual void render(MobiDOT &display) = 0;
+
+private:
+    friend class MobiDOT;
+
+    // Dirty widgets are rendered again on the next update
+    bool DIRTY = true;
+
+    // Commands added to the display buffer during the last render
+    char *CACHE_DATA = nullptr;
+    uint CACHE_SIZE = 0;
+
+    /**
+     * draw function
+     * Clears the bounds of the widget and renders it
+     * @param display Display to draw on
+     */
+    void draw(MobiDOT &display);
+};
+
+/**
+ * @class MobiDOTTextWidget class
+ * Draws a string using either a font built into the display or a GFXfont
+ */
+class MobiDOTTextWidget : public MobiDOTWidget
+{
+public:
+    /**
+     * MobiDOTTextWidget class constructor
+     * @param text String to display, copied into the widget (max MOBIDOT_WIDGET_TEXT_SIZE - 1 characters)
+     * @param font Font built into the display or GFXfont
+     * @param x Horizontal offset
+     * @param y Vertical offset
+     * @param width Width of the area the widget draws in
+     * @param height Height of the area the widget draws in
+     * @param invert Invert text, only works with GFXfonts
+     */
+    MobiDOTTextWidget(const char text[], MobiDOT::Font font, int x, int y, uint width, uint height);
+    MobiDOTTextWidget(const char text[], const GFXfont *font, int x, int y, uint width, uint height, bool invert = false);
+
+    /**
+     * setText function
+     * Changes the displayed string, the widget is only invalidated if the string actually changed
+     * @param text String to display
+     */
+    void setText(const char text[]);
+
+    /**
+     * getText function
+     * @returns Currently displayed string
+     */
+    const char *getText();
+
+protected:
+    void render(MobiDOT &display) override;
+
+private:
+    char TEXT[MOBIDOT_WIDGET_TEXT_SIZE] = {0};
+
+    // Either FONT_GFX is set or FONT is used
+    MobiDOT::Font FONT = MobiDOT::Font::TEXT_7PX;
+    const GFXfont *FONT_GFX = nullptr;
+    bool INVERT = false;
+};
+
+/**
+ * @class MobiDOTBitmapWidget class
+ * Draws a bitmap encoded using image2cpp, see MobiDOT::drawBitmap()
+ */
+class MobiDOTBitmapWidget : public MobiDOTWidget
+{
+public:
+    /**
+     * MobiDOTBitmapWidget class constructor
+     * @param data Bitmap data, not copied, it has to stay alive as long as the widget
+     * @param width Width of the image
+     * @param height Height of the image
+     * @param x Horizontal offset
+     * @param y Vertical offset
+     * @param invert Inverts image data if true
+     */
+    MobiDOTBitmapWidget(const unsigned char data[], uint width, uint height, int x, int y, bool invert = false);
+
+    /**
+     * setBitmap function
+     * Changes the bitmap and invalidates the widget. Call invalidate() instead if the data was changed in place
+     * @param data Bitmap data with the same dimensions as the previous bitmap
+     */
+    void setBitmap(const unsigned char data[]);
+
+protected:
+    void render(MobiDOT &display) override;
+
+private:
+    const unsigned char *DATA;
+    bool INVERT;
+};
+
+/**
+ * @class MobiDOTClockWidget class
+ * Displays a time as hh:mm or hh:mm:ss
+ */
+class MobiDOTClockWidget : public MobiDOTTextWidget
+{
+public:
+    MobiDOTClockWidget(MobiDOT::Font font, int x, int y, uint width, uint height, bool seconds = false);
+    MobiDOTClockWidget(const GFXfont *font, int x, int y, uint width, uint height, bool seconds = false, bool invert = false);
+
+    /**
+     * setTime function
+     * Sets the displayed time, the widget is only invalidated if the visible digits changed
+     * @param hours Hours (0 - 23)
+     * @param minutes Minutes (0 - 59)
+     * @param seconds Seconds (0 - 59), ignored if the clock does not display seconds
+     */
+    void setTime(uint8_t hours, uint8_t minutes, uint8_t seconds = 0);
+
+private:
+    bool SECONDS;
+};
+
+/**
+ * @class MobiDOTCounterWidget class
+ * Displays a number, optionally padded with zeros up to MOBIDOT_COUNTER_DIGITS digits
+ */
+class MobiDOTCounterWidget : public MobiDOTTextWidget
+{
+public:
+    MobiDOTCounterWidget(MobiDOT::Font font, int x, int y, uint width, uint height, uint8_t digits = 0);
+    MobiDOTCounterWidget(const GFXfont *font, int x, int y, uint width, uint height, uint8_t digits = 0, bool invert = false);
+
+    /**
+     * setValue function
+     * Sets the displayed number, the widget is only invalidated if the value changed
+     * @param value Number to display
+     */
+    void setValue(int32_t value);
+
+    /**
+     * getValue function
+     * @returns Currently displayed number
+     */
+    int32_t getValue();
+
+private:
+    int32_t VALUE = 0;
+    uint8_t DIGITS;
+};
+
+#endif // _MOBIDOT_WIDGET_HPP_
@@ -0,0 +1,193 @@
+/**
+ * @file upload.cpp
+ * Streams uploaded content files (fonts, bitmaps, frame sets) straight into LittleFS
+ *
+ * Arne van Iterson, 2023
+ */
+
+#include "./upload.hpp"
+
+void ContentUpload::chunk(AsyncWebServerRequest *request, const char filename[], size_t index, uint8_t *data, size_t len)
+{
+    // First chunk starts the upload
+    if (index == 0)
+    {
+        // Another request is still uploading, this one will be refused in respond()
+        if (this->OWNER != nullptr && this->OWNER != request)
+        {
+            return;
+        }
+
+        // A multipart body can hold more than one file, only the first is stored
+        if (this->OWNER == request)
+        {
+            this->STATUS = (this->STATUS) ? this->STATUS : 400;
+            this->abort();
+            return;
+        }
+
+        this->OWNER = request;
+
+        // Clean up if the client goes away halfway through, also when begin() fails and respond() is never called
+        request->onDisconnect(
+            [this, request]()
+            {
+                if (this->OWNER == request)
+                {
+                    this->abort();
+                    this->OWNER = nullptr;
+                }
+            });
+
+        this->STATUS = this->begin(request, filename);
+    }
+
+    if (this->OWNER != request || this->STATUS)
+    {
+        return;
+    }
+
+    // Chunks have to arrive in order, anything else means part of the body got lost
+    if (index != this->SIZE)
+    {
+        this->STATUS = 400;
+        this->abort();
+        return;
+    }
+
+    if (this->FILE.write(data, len) != len)
+    {
+        this->STATUS = 507;
+        this->abort();
+        return;
+    }
+
+    this->CRC = ContentUpload::crc32(this->CRC, data, len);
+    this->SIZE += len;
+}
+
+void ContentUpload::respond(AsyncWebServerRequest *request)
+{
+    if (this->OWNER != request)
+    {
+        // Either there was no body at all or another upload was active
+        request->send((this->OWNER == nullptr) ? 400 : 409, "text/json", "{}");
+        return;
+    }
+
+    int status = this->STATUS;
+
+    // Check the CRC if the client supplied one
+    if (!status && request->hasParam("crc"))
+    {
+        const uint32_t expected = strtoul(request->getParam("crc")->value().c_str(), nullptr, 16);
+        if (expected != this->CRC)
+        {
+            status = 422;
+        }
+    }
+
+    if (!status)
+    {
+        this->FILE.close();
+
+        // Move the complete file in place, rename replaces the old version in one step
+        if (!LittleFS.rename(this->TEMP, this->PATH))
+        {
+            status = 500;
+        }
+    }
+
+    if (status)
+    {
+        this->abort();
+        request->send(status, "text/json", "{}");
+    }
+    else
+    {
+        char json[80];
+        snprintf(json, sizeof(json), "{\"path\":\"%s\",\"size\":%u,\"crc\":\"%08x\"}", this->PATH, (uint)this->SIZE, this->CRC);
+        request->send(200, "text/json", json);
+    }
+
+    this->OWNER = nullptr;
+}
+
+int ContentUpload::begin(AsyncWebServerRequest *request, const char filename[])
+{
+    // Determine target path
+    const char *path = nullptr;
+    if (request->hasParam("path"))
+    {
+        path = request->getParam("path")->value().c_str();
+    }
+    else if (filename != nullptr && filename[0] != 0)
+    {
+        path = filename;
+    }
+
+    if (path == nullptr)
+    {
+        return 400;
+    }
+
+    // Paths are always absolute and have to fit, don't allow walking out of directories
+    if (path[0] == '/')
+    {
+        strncpy(this->PATH, path, sizeof(this->PATH));
+    }
+    else
+    {
+        this->PATH[0] = '/';
+        strncpy(this->PATH + 1, path, sizeof(this->PATH) - 1);
+    }
+
+    if (this->PATH[sizeof(this->PATH) - 1] != 0 || strstr(this->PATH, "..") != nullptr)
+    {
+        this->PATH[0] = 0;
+        return 400;
+    }
+
+    snprintf(this->TEMP, sizeof(this->TEMP), "%s" UPLOAD_TEMP_SUFFIX, this->PATH);
+
+    this->FILE = LittleFS.open(this->TEMP, "w");
+    if (!this->FILE)
+    {
+        return 500;
+    }
+
+    this->CRC = 0;
+    this->SIZE = 0;
+
+    return 0;
+}
+
+void ContentUpload::abort()
+{
+    if (this->FILE)
+    {
+        this->FILE.close();
+    }
+
+    if (this->TEMP[0] != 0)
+    {
+        LittleFS.remove(this->TEMP);
+        this->TEMP[0] = 0;
+    }
+}
+
+uint32_t ContentUpload::crc32(uint32_t crc, const uint8_t data[], size_t len)
+{
+    // Nibble table, small enough to keep in flash
+    static const uint32_t table[16] PROGMEM = {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+        0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c};
+
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc = (crc >> 4) ^ pgm_read_dword(&table[(crc ^ data[i]) & 0x0f]);
+        crc = (crc >> 4) ^ pgm_read_dword(&table[(crc ^ (data[i] >> 4)) & 0x0f]);
+    }
+    return ~crc;
+}
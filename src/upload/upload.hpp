@@ -0,0 +1,89 @@
+/**
+ * @file upload.hpp
+ * Streams uploaded content files (fonts, bitmaps, frame sets) straight into LittleFS
+ *
+ * Chunks from the AsyncWebServer upload (multipart) or body (raw) callbacks are written to a temporary file
+ * while a CRC32 is calculated, the file is only renamed to its final path if the upload completed and the CRC matches.
+ * Only one upload can be active at a time, nothing is buffered in RAM.
+ *
+ * Arne van Iterson, 2023
+ */
+
+#ifndef _UPLOAD_HPP_
+#define _UPLOAD_HPP_
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <ESPAsyncWebServer.h>
+
+/* Upload constants */
+#define UPLOAD_PATH_SIZE 32
+#define UPLOAD_TEMP_SUFFIX ".part"
+
+/**
+ * @class ContentUpload class
+ */
+class ContentUpload
+{
+public:
+    /**
+     * chunk function
+     * Handles a chunk of an upload, call this from both the upload and the body callback.
+     * The target path is taken from the 'path' query parameter, or the filename of a multipart upload.
+     * A multipart body with more than one file is refused with 400, nothing of it is stored
+     * @param request Request the chunk belongs to
+     * @param filename Filename of a multipart upload, nullptr for a raw body
+     * @param index Offset of the chunk in the file
+     * @param data Chunk data
+     * @param len Size of the chunk
+     */
+    void chunk(AsyncWebServerRequest *request, const char filename[], size_t index, uint8_t *data, size_t len);
+
+    /**
+     * respond function
+     * Finishes the upload of a request and sends the response, call this from the request callback.
+     * If the 'crc' query parameter is given (CRC32 as hex), the file is only stored if it matches
+     * @param request Request to respond to
+     */
+    void respond(AsyncWebServerRequest *request);
+
+private:
+    // Request that owns the current upload, nullptr if idle
+    AsyncWebServerRequest *OWNER = nullptr;
+
+    File FILE;
+    char PATH[UPLOAD_PATH_SIZE] = {0};
+    char TEMP[UPLOAD_PATH_SIZE + sizeof(UPLOAD_TEMP_SUFFIX)] = {0};
+
+    // Running state of the current upload
+    uint32_t CRC = 0;
+    size_t SIZE = 0;
+    int STATUS = 0;
+
+    /**
+     * begin function
+     * Opens the temporary file for a new upload
+     * @param request Request that starts the upload
+     * @param filename Filename of a multipart upload, nullptr for a raw body
+     * @returns HTTP status code on error, 0 if the upload started
+     */
+    int begin(AsyncWebServerRequest *request, const char filename[]);
+
+    /**
+     * abort function
+     * Closes and removes the temporary file of the current upload
+     */
+    void abort();
+
+    /**
+     * crc32 function
+     * Continues a CRC32 (IEEE 802.3) over the input data
+     * @param crc CRC of the previous data, 0 for the first chunk
+     * @param data Input data
+     * @param len Size of the input data
+     * @returns CRC including the input data
+     */
+    static uint32_t crc32(uint32_t crc, const uint8_t data[], size_t len);
+};
+
+#endif // _UPLOAD_HPP_
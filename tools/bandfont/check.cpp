@@ -0,0 +1,98 @@
+/**
+ * @file check.cpp
+ * Host check of fonts converted with MOBIDOT_BAND_FONT
+ *
+ * Converts gfxfont/tiny3x5.h and a font with glyphs reaching outside of their advance at compile time, prints
+ * strings with both the converted font and the GFXfont it came from and compares what the display would show. The
+ * converted font goes through MobiDOT::print() and the bus into the framebuffer, the GFXfont is rasterized by
+ * MobiDOTBands::print().
+ *
+ * Build: g++ -std=c++17 -O2 -I tools/loadtest/host -I src -o mobidot-bandfont tools/bandfont/check.cpp src/mobidot/[a-z]*.cpp
+ * Usage: mobidot-bandfont
+ * Exits with status 1 if any string differs.
+ *
+ * Arne van Iterson, 2023
+ */
+
+#include <Arduino.h>
+#include <SoftwareSerial.h>
+
+#include "mobidot/mobidot.hpp"
+#include "mobidot/bands.hpp"
+#include "mobidot/bandfont.hpp"
+#include "gfxfont/tiny3x5.h"
+
+MOBIDOT_BAND_FONT(Tiny3x5Bands, Tiny3x5Bitmaps, Tiny3x5Glyphs, 0x20);
+
+/* Slanted glyphs that start left of the cursor and end beyond their advance, like italic fonts */
+constexpr uint8_t SlantedBitmaps[] PROGMEM = {0x12, 0x48, 0x0f, 0x84, 0x20, 0xf8};
+constexpr GFXglyph SlantedGlyphs[] PROGMEM = {
+    {0, 0, 0, 3, 0, 0},   // 0x20 ' '
+    {0, 4, 4, 3, -1, -4}, // 0x21 '!'
+    {2, 5, 4, 2, 0, -4},  // 0x22 '"'
+};
+const GFXfont Slanted PROGMEM = {(uint8_t *)SlantedBitmaps, (GFXglyph *)SlantedGlyphs, 0x20, 0x22, 5};
+
+MOBIDOT_BAND_FONT(SlantedBands, SlantedBitmaps, SlantedGlyphs, 0x20);
+
+/**
+ * check function
+ * Prints a string with both fonts on an empty display
+ * @returns True if the display shows the same for both
+ */
+static bool check(const char text[], const GFXfont &font, const MobiDOTBandFont &bands, MobiDOT::Display type, int x, int y)
+{
+    MobiDOT mobidot(/* rx */ 0, /* tx */ 0, /* ctrl */ 0);
+    mobidot.selectDisplay(type);
+    mobidot.print(text, bands, x, y);
+    mobidot.update();
+    while (mobidot.isBusy())
+    {
+        mobidot.loop();
+    }
+
+    MobiDOTBands expected(mobidot.getWidth(type), mobidot.getHeight(type));
+    expected.print(text, &font, x, y);
+
+    const MobiDOTBands &shown = mobidot.getFramebuffer(type);
+    bool same = true;
+    for (uint i = 0; i < expected.getBands(); i++)
+    {
+        same = same && memcmp(expected.getBand(i), shown.getBand(i), expected.getWidth()) == 0;
+    }
+
+    printf("%-4s \"%s\" at %d,%d\n", (same) ? "ok" : "FAIL", text, x, y);
+    if (!same)
+    {
+        for (uint row = 0; row < expected.getHeight(); row++)
+        {
+            for (uint col = 0; col < expected.getWidth(); col++)
+            {
+                putchar(expected.getPixel(col, row) ? '#' : '.');
+            }
+            printf("   ");
+            for (uint col = 0; col < expected.getWidth(); col++)
+            {
+                putchar(shown.getPixel(col, row) ? '#' : '.');
+            }
+            putchar('\n');
+        }
+    }
+    return same;
+}
+
+int main()
+{
+    softwareSerialPaced = false;
+
+    bool result = true;
+    result &= check("12:34", Tiny3x5, Tiny3x5Bands, MobiDOT::Display::REAR, 0, 0);
+    result &= check("-0.5%", Tiny3x5, Tiny3x5Bands, MobiDOT::Display::REAR, 1, 2);
+    result &= check("0123456789", Tiny3x5, Tiny3x5Bands, MobiDOT::Display::SIDE, 3, 1);
+    result &= check("#$&()*+,/!", Tiny3x5, Tiny3x5Bands, MobiDOT::Display::FRONT, 20, 9);
+    result &= check("9:59", Tiny3x5, Tiny3x5Bands, MobiDOT::Display::SIDE, -2, 0);
+    result &= check("!\"!\"", Slanted, SlantedBands, MobiDOT::Display::SIDE, 4, 0);
+    result &= check("!!\" !", Slanted, SlantedBands, MobiDOT::Display::SIDE, 0, 2);
+
+    return (result) ? 0 : 1;
+}
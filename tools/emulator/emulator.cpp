@@ -0,0 +1,415 @@
+/**
+ * @file emulator.cpp
+ * Reference MobiDOT sign emulator
+ *
+ * Host side decoder for the byte stream MobiDOT::update() sends over the RS485 bus. Frames are parsed, checked
+ * (checksum, framing, geometry) and applied to an emulated pixel matrix per display, which keeps its content
+ * between frames like the real sign. For every frame the amount of bytes and the amount of pixels that actually
+ * changed are reported, so the wire size of drawing and diffing changes can be checked without hardware.
+ *
+ * Build: g++ -std=c++17 -O2 -I tools/loadtest/host -I src -o mobidot-emu tools/emulator/emulator.cpp
+ * Usage: mobidot-emu [--hex] [--quiet] [capture ...]
+ *   --hex    Input is hexadecimal text instead of raw bytes (whitespace is ignored)
+ *   --quiet  Only print the frame summaries, not the pixel matrix
+ *   capture  Files holding the captured bus data, stdin if none are given
+ * Exits with status 1 if any frame contained an error.
+ *
+ * Arne van Iterson, 2023
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "mobidot/mobidot.hpp"
+#include "mobidot/bands.hpp"
+
+/**
+ * @struct Sign
+ * Emulated display
+ */
+struct Sign
+{
+    const char *name;
+    uint8_t address;
+    int width;
+    int height;
+    std::vector<bool> pixels;
+};
+
+static Sign signs[] = {
+    {"FRONT", MOBIDOT_ADDRESS_FRONT, MOBIDOT_WIDTH_FRONT, MOBIDOT_HEIGHT_FRONT, {}},
+    {"REAR", MOBIDOT_ADDRESS_REAR, MOBIDOT_WIDTH_REAR, MOBIDOT_HEIGHT_REAR, {}},
+    {"SIDE", MOBIDOT_ADDRESS_SIDE, MOBIDOT_WIDTH_SIDE, MOBIDOT_HEIGHT_SIDE, {}},
+};
+
+struct Options
+{
+    bool hex = false;
+    bool quiet = false;
+};
+
+/**
+ * Frame statistics
+ */
+struct Result
+{
+    size_t bytes = 0;
+    size_t segments = 0;
+    size_t columns = 0;
+    size_t changed = 0;
+    size_t clipped = 0;
+    std::vector<std::string> errors;
+    std::vector<std::string> notes;
+};
+
+static std::string format(const char *fmt, int a, int b = 0, int c = 0)
+{
+    char text[128];
+    snprintf(text, sizeof(text), fmt, a, b, c);
+    return text;
+}
+
+static Sign *findSign(uint8_t address)
+{
+    for (Sign &sign : signs)
+    {
+        if (sign.address == address)
+        {
+            return &sign;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Decodes the body of a frame (address up to the checksum) and applies it to the sign
+ */
+static void decode(const std::vector<uint8_t> &body, Result &result, Sign *&target)
+{
+    if (body.size() < 2)
+    {
+        result.errors.push_back("frame too short");
+        return;
+    }
+
+    Sign *sign = findSign(body[0]);
+    if (sign == nullptr)
+    {
+        result.errors.push_back(format("unknown address 0x%02x", body[0]));
+        return;
+    }
+    target = sign;
+
+    if (body[1] != MOBIDOT_MODE_ASCII)
+    {
+        result.errors.push_back(format("unsupported mode 0x%02x", body[1]));
+        return;
+    }
+
+    if (sign->pixels.empty())
+    {
+        sign->pixels.assign(sign->width * sign->height, false);
+    }
+
+    int width = -1;
+    int height = -1;
+    int x = 0;
+    int y = 0;
+    int font = -1;
+    std::string text;
+
+    auto flushText = [&]()
+    {
+        if (!text.empty())
+        {
+            result.notes.push_back(format("text in font 0x%02x at %d,%d not rendered: ", font, x, y) + text);
+            text.clear();
+        }
+    };
+
+    for (size_t i = 2; i < body.size(); i++)
+    {
+        const uint8_t value = body[i];
+
+        // Commands take one argument
+        if (value >= 0xd0 && value <= 0xd4)
+        {
+            if (i + 1 >= body.size())
+            {
+                result.errors.push_back(format("command 0x%02x without argument", value));
+                return;
+            }
+
+            flushText();
+            const uint8_t argument = body[++i];
+            switch (value)
+            {
+            case 0xd0:
+                width = argument;
+                break;
+            case 0xd1:
+                height = argument;
+                break;
+            case 0xd2:
+                x = argument;
+                break;
+            case 0xd3:
+                y = argument;
+                break;
+            case 0xd4:
+                font = argument;
+                if (font == (uint8_t)MobiDOT::Font::BITWISE)
+                {
+                    result.segments++;
+                }
+                break;
+            }
+            continue;
+        }
+
+        if (width != sign->width || height != sign->height)
+        {
+            result.errors.push_back(format("geometry %dx%d does not match the display", width, height) +
+                                    format(" (%dx%d)", sign->width, sign->height));
+            return;
+        }
+
+        if (font != (uint8_t)MobiDOT::Font::BITWISE)
+        {
+            if (font < 0)
+            {
+                result.errors.push_back(format("data byte 0x%02x before a font was selected", value));
+                return;
+            }
+            text += (char)value;
+            continue;
+        }
+
+        // BITWISE column: 001xxxxx, bit 0 is the top row, y is the bottom row of the band
+        if ((value & 0xe0) != 0x20)
+        {
+            result.errors.push_back(format("invalid BITWISE byte 0x%02x at %d,%d", value, x, y));
+            return;
+        }
+
+        result.columns++;
+        const int top = y - (MOBIDOT_BAND_HEIGHT - 1);
+        for (int k = 0; k < MOBIDOT_BAND_HEIGHT; k++)
+        {
+            const int row = top + k;
+            if (x >= sign->width || row < 0 || row >= sign->height)
+            {
+                // Bands overlapping the bottom of the display are normal, only count them
+                result.clipped++;
+                continue;
+            }
+
+            const bool on = value >> k & 0x01;
+            const size_t index = row * sign->width + x;
+            if (sign->pixels[index] != on)
+            {
+                sign->pixels[index] = on;
+                result.changed++;
+            }
+        }
+        x++;
+    }
+    flushText();
+}
+
+/**
+ * Splits the stream into frames and decodes them
+ */
+static bool run(const std::vector<uint8_t> &stream, const Options &options)
+{
+    bool ok = true;
+    size_t frame = 0;
+    size_t i = 0;
+
+    while (i < stream.size())
+    {
+        // Padding between frames, the library sends a 0x00 after every stop byte
+        if (stream[i] != MOBIDOT_BYTE_START)
+        {
+            if (stream[i] != 0x00)
+            {
+                printf("offset %zu: skipping 0x%02x outside of a frame\n", i, stream[i]);
+                ok = false;
+            }
+            i++;
+            continue;
+        }
+
+        // Frame runs until the stop byte, data bytes are never 0xff
+        const size_t start = i++;
+        while (i < stream.size() && stream[i] != MOBIDOT_BYTE_STOP)
+        {
+            i++;
+        }
+
+        Result result;
+        result.bytes = i - start + 1;
+        std::vector<uint8_t> body(stream.begin() + start + 1, stream.begin() + i);
+
+        if (i >= stream.size())
+        {
+            result.errors.push_back("missing stop byte");
+        }
+        i++;
+
+        // Checksum is escaped if it collides with 0xfe or 0xff
+        int checksum = -1;
+        if (body.size() >= 2 && body[body.size() - 2] == 0xfe && body.back() <= 0x01)
+        {
+            checksum = (body.back() == 0x00) ? 0xfe : 0xff;
+            body.resize(body.size() - 2);
+        }
+        else if (!body.empty())
+        {
+            checksum = body.back();
+            body.pop_back();
+        }
+
+        unsigned sum = 0;
+        for (uint8_t value : body)
+        {
+            sum += value;
+        }
+
+        Sign *sign = nullptr;
+        if (checksum != (int)(sum & 0xff))
+        {
+            // The sign discards these frames, so they are not applied
+            result.errors.push_back(format("checksum 0x%02x, expected 0x%02x", checksum, sum & 0xff));
+        }
+        else
+        {
+            decode(body, result, sign);
+        }
+
+        if (i < stream.size() && stream[i] == 0x00)
+        {
+            result.bytes++;
+            i++;
+        }
+
+        printf("frame %zu @%zu %s: %zu bytes, %zu segments, %zu columns, %zu pixels changed",
+               frame++, start, (sign) ? sign->name : "?", result.bytes, result.segments, result.columns, result.changed);
+        if (result.changed)
+        {
+            printf(", %.2f bytes/changed pixel", (double)result.bytes / result.changed);
+        }
+        if (result.clipped)
+        {
+            printf(", %zu pixels clipped", result.clipped);
+        }
+        printf("\n");
+
+        for (const std::string &note : result.notes)
+        {
+            printf("  note: %s\n", note.c_str());
+        }
+        for (const std::string &error : result.errors)
+        {
+            printf("  error: %s\n", error.c_str());
+        }
+        ok = ok && result.errors.empty();
+
+        if (!options.quiet && sign != nullptr && result.errors.empty())
+        {
+            for (int row = 0; row < sign->height; row++)
+            {
+                printf("  ");
+                for (int col = 0; col < sign->width; col++)
+                {
+                    putchar(sign->pixels[row * sign->width + col] ? '#' : '.');
+                }
+                putchar('\n');
+            }
+        }
+    }
+
+    return ok;
+}
+
+static bool read(std::istream &input, const Options &options, std::vector<uint8_t> &stream)
+{
+    const std::string data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+    if (!options.hex)
+    {
+        stream.insert(stream.end(), data.begin(), data.end());
+        return true;
+    }
+
+    int nibble = -1;
+    for (char c : data)
+    {
+        int value;
+        if (c >= '0' && c <= '9')
+            value = c - '0';
+        else if (c >= 'a' && c <= 'f')
+            value = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            value = c - 'A' + 10;
+        else if (isspace((unsigned char)c) || c == ',')
+            continue;
+        else
+            return false;
+
+        if (nibble < 0)
+        {
+            nibble = value;
+        }
+        else
+        {
+            stream.push_back(nibble << 4 | value);
+            nibble = -1;
+        }
+    }
+    return nibble < 0;
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--hex") == 0)
+            options.hex = true;
+        else if (strcmp(argv[i], "--quiet") == 0)
+            options.quiet = true;
+        else
+            files.push_back(argv[i]);
+    }
+
+    std::vector<uint8_t> stream;
+    if (files.empty())
+    {
+        if (!read(std::cin, options, stream))
+        {
+            fprintf(stderr, "stdin: invalid hex data\n");
+            return 2;
+        }
+    }
+
+    for (const std::string &file : files)
+    {
+        std::ifstream input(file, std::ios::binary);
+        if (!input || !read(input, options, stream))
+        {
+            fprintf(stderr, "%s: could not read\n", file.c_str());
+            return 2;
+        }
+    }
+
+    return run(stream, options) ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file Arduino.h
+ * Minimal Arduino core for building the MobiDOT library, the command core and the serial link on a host,
+ * see server.cpp and tools/serial/device.cpp
+ *
+ * Only what src/mobidot, src/command and src/link use is provided. Pins do nothing, time is taken from the steady clock.
+ *
+ * Arne van Iterson, 2023
+ */
+
+#ifndef _HOST_ARDUINO_H_
+#define _HOST_ARDUINO_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+typedef unsigned int uint;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+
+/* Binary constants used by the library, see binary.h of the Arduino core */
+#define B00000001 1
+
+/* Flash is ordinary memory on a host */
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr) (*(const void *const *)(addr))
+
+using std::max;
+using std::min;
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+
+inline unsigned long micros()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline unsigned long millis()
+{
+    return micros() / 1000;
+}
+
+inline void delay(unsigned long ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+inline void yield() {}
+
+/**
+ * @class Stream class
+ * Serial port as used by src/link, tools/serial/device.cpp implements it on a pseudo terminal
+ */
+class Stream
+{
+public:
+    virtual ~Stream() {}
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual size_t write(const uint8_t *data, size_t size) = 0;
+};
+
+#endif // _HOST_ARDUINO_H_
@@ -0,0 +1,50 @@
+/**
+ * @file SoftwareSerial.h
+ * Simulated RS485 port for building the MobiDOT library on a host, see server.cpp
+ *
+ * Writing blocks for as long as the bytes take on the bus at the configured baud rate, like SoftwareSerial does on
+ * the ESP8266, so the host server stalls on the bus exactly where the sign controller would.
+ * Set softwareSerialPaced to false to measure without the bus.
+ *
+ * Arne van Iterson, 2023
+ */
+
+#ifndef _HOST_SOFTWARESERIAL_H_
+#define _HOST_SOFTWARESERIAL_H_
+
+#include "Arduino.h"
+
+#define SWSERIAL_8N1 0
+
+/* Wait for the bus time on every write */
+inline bool softwareSerialPaced = true;
+
+/* Bytes written by all ports */
+inline uint64_t softwareSerialBytes = 0;
+
+class SoftwareSerial
+{
+public:
+    void begin(uint32_t baud, int, int8_t, int8_t)
+    {
+        this->BAUD = baud;
+    }
+
+    void end() {}
+
+    size_t write(const char *, size_t size)
+    {
+        softwareSerialBytes += size;
+        if (softwareSerialPaced)
+        {
+            // 8N1: a start bit, 8 data bits and a stop bit per byte
+            std::this_thread::sleep_for(std::chrono::microseconds((uint64_t)size * 10 * 1000000 / this->BAUD));
+        }
+        return size;
+    }
+
+private:
+    uint32_t BAUD = 4800;
+};
+
+#endif // _HOST_SOFTWARESERIAL_H_
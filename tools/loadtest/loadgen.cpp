@@ -0,0 +1,378 @@
+/**
+ * @file loadgen.cpp
+ * Load generator for the MobiDOT command endpoints
+ *
+ * Every connection uploads random frames to the rear display as fast as it can, the same way the web app does:
+ * POST /command/base64 with the bitmap followed by POST /command/update. Works against the host server
+ * (server.cpp) as well as the ESP8266. Afterwards the frame counters of GET /status are compared to the amount of
+ * frames uploaded, frames that were neither sent nor coalesced with another frame count as dropped.
+ *
+ * Build: g++ -std=c++17 -O2 -pthread -o mobidot-loadgen tools/loadtest/loadgen.cpp
+ * Usage: mobidot-loadgen [--host 127.0.0.1] [--port 8080] [--connections 4] [--duration 10] [--urgent 0] [--distinct 0]
+ *   --connections  Concurrent connections, each with its own thread
+ *   --duration     Seconds to run
+ *   --urgent       Percentage of updates sent with priority=urgent
+ *   --distinct     Pick every frame from this many different bitmaps, like a sign repeating its content.
+ *                  0 makes every frame random
+ * Exits with status 1 if any request failed or any frame was dropped.
+ *
+ * Arne van Iterson, 2023
+ */
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <random>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/* Bitmap of the rear display, see COMMAND_BITMAP_SIZE */
+#define BITMAP_SIZE (14 * ((21 + 7) / 8))
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options
+{
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    int connections = 4;
+    int duration = 10;
+    int urgent = 0;
+    int distinct = 0;
+};
+
+/**
+ * Per connection results
+ */
+struct Result
+{
+    std::vector<double> latencies; // Milliseconds per request
+    uint64_t requests = 0;
+    uint64_t failed = 0;
+    uint64_t frames = 0; // Updates that were accepted
+};
+
+/**
+ * @class Connection class
+ * Keep-alive HTTP/1.1 connection, reconnects when the server closes it
+ */
+class Connection
+{
+public:
+    Connection(const Options &options) : OPTIONS(options) {}
+
+    ~Connection()
+    {
+        this->disconnect();
+    }
+
+    /**
+     * request function
+     * @returns HTTP status, -1 if the request failed
+     */
+    int request(const char method[], const char path[], const std::string &body, std::string &response)
+    {
+        if (this->FD < 0 && !this->connect())
+        {
+            return -1;
+        }
+
+        char head[256];
+        snprintf(head, sizeof(head),
+                 "%s %s HTTP/1.1\r\nHost: %s\r\nContent-Type: application/x-www-form-urlencoded\r\nContent-Length: %zu\r\n\r\n",
+                 method, path, this->OPTIONS.host.c_str(), body.size());
+        const std::string data = head + body;
+
+        if (send(this->FD, data.data(), data.size(), MSG_NOSIGNAL) != (ssize_t)data.size())
+        {
+            this->disconnect();
+            return -1;
+        }
+
+        // Read the header, then as much body as announced
+        std::string input;
+        size_t headerEnd;
+        while ((headerEnd = input.find("\r\n\r\n")) == std::string::npos)
+        {
+            if (!this->receive(input))
+            {
+                return -1;
+            }
+        }
+
+        size_t length = 0;
+        const char *contentLength = strcasestr(input.c_str(), "\r\ncontent-length:");
+        if (contentLength != nullptr && (size_t)(contentLength - input.c_str()) < headerEnd)
+        {
+            length = strtoul(contentLength + 17, nullptr, 10);
+        }
+        while (input.size() < headerEnd + 4 + length)
+        {
+            if (!this->receive(input))
+            {
+                return -1;
+            }
+        }
+
+        response = input.substr(headerEnd + 4, length);
+        return atoi(input.c_str() + 9); // HTTP/1.1 200
+    }
+
+private:
+    const Options &OPTIONS;
+    int FD = -1;
+
+    bool connect()
+    {
+        this->FD = socket(AF_INET, SOCK_STREAM, 0);
+        const int yes = 1;
+        setsockopt(this->FD, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+        // Requests that take longer than this count as failed
+        timeval timeout = {10, 0};
+        setsockopt(this->FD, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(this->OPTIONS.port);
+        inet_pton(AF_INET, this->OPTIONS.host.c_str(), &address.sin_addr);
+
+        if (::connect(this->FD, (sockaddr *)&address, sizeof(address)) != 0)
+        {
+            this->disconnect();
+            return false;
+        }
+        return true;
+    }
+
+    void disconnect()
+    {
+        if (this->FD >= 0)
+        {
+            close(this->FD);
+            this->FD = -1;
+        }
+    }
+
+    bool receive(std::string &input)
+    {
+        char data[1024];
+        const ssize_t received = recv(this->FD, data, sizeof(data), 0);
+        if (received <= 0)
+        {
+            this->disconnect();
+            return false;
+        }
+        input.append(data, received);
+        return true;
+    }
+};
+
+/**
+ * @returns Bitmap as the web app sends it: hexadecimal string, base64 encoded, form encoded
+ */
+static std::string encodeBitmap(const uint8_t bitmap[])
+{
+    static const char hex[] = "0123456789abcdef";
+    static const char base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    std::string text;
+    for (size_t i = 0; i < BITMAP_SIZE; i++)
+    {
+        text += hex[bitmap[i] >> 4];
+        text += hex[bitmap[i] & 0x0f];
+    }
+
+    std::string encoded;
+    for (size_t i = 0; i < text.size(); i += 3)
+    {
+        uint32_t value = (uint8_t)text[i] << 16;
+        value |= (i + 1 < text.size()) ? (uint8_t)text[i + 1] << 8 : 0;
+        value |= (i + 2 < text.size()) ? (uint8_t)text[i + 2] : 0;
+
+        encoded += base64[value >> 18 & 0x3f];
+        encoded += base64[value >> 12 & 0x3f];
+        encoded += (i + 1 < text.size()) ? base64[value >> 6 & 0x3f] : '=';
+        encoded += (i + 2 < text.size()) ? base64[value & 0x3f] : '=';
+    }
+
+    std::string body = "data=";
+    for (char c : encoded)
+    {
+        switch (c)
+        {
+        case '+':
+            body += "%2B";
+            break;
+        case '/':
+            body += "%2F";
+            break;
+        case '=':
+            body += "%3D";
+            break;
+        default:
+            body += c;
+        }
+    }
+    return body;
+}
+
+/**
+ * @returns Value of a number in the JSON of GET /status, -1 if it is missing
+ */
+static long long statusValue(const std::string &json, const char name[])
+{
+    const std::string key = std::string("\"") + name + "\":";
+    const size_t position = json.find(key);
+    return (position == std::string::npos) ? -1 : atoll(json.c_str() + position + key.size());
+}
+
+static void worker(const Options &options, int index, Clock::time_point end, Result &result)
+{
+    Connection connection(options);
+    std::mt19937 random(index);
+    std::string response;
+
+    while (Clock::now() < end)
+    {
+        // Repeated bitmaps are generated from the same seed, so every connection uses the same set
+        uint8_t bitmap[BITMAP_SIZE];
+        std::mt19937 content((options.distinct > 0) ? random() % options.distinct : random());
+        for (uint8_t &value : bitmap)
+        {
+            value = content();
+        }
+        const bool urgent = (int)(random() % 100) < options.urgent;
+
+        const std::string bodies[] = {encodeBitmap(bitmap), (urgent) ? "priority=urgent" : ""};
+        const char *paths[] = {"/command/base64", "/command/update"};
+
+        for (int i = 0; i < 2; i++)
+        {
+            const Clock::time_point start = Clock::now();
+            const int status = connection.request("POST", paths[i], bodies[i], response);
+            result.latencies.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+            result.requests++;
+
+            if (status != 200)
+            {
+                result.failed++;
+                break;
+            }
+            if (i == 1)
+            {
+                result.frames++;
+            }
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        const bool value = i + 1 < argc;
+        if (strcmp(argv[i], "--host") == 0 && value)
+            options.host = argv[++i];
+        else if (strcmp(argv[i], "--port") == 0 && value)
+            options.port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--connections") == 0 && value)
+            options.connections = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--duration") == 0 && value)
+            options.duration = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--urgent") == 0 && value)
+            options.urgent = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--distinct") == 0 && value)
+            options.distinct = std::max(0, atoi(argv[++i]));
+        else
+        {
+            fprintf(stderr, "usage: %s [--host 127.0.0.1] [--port 8080] [--connections 4] [--duration 10] [--urgent 0] [--distinct 0]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    Connection control(options);
+    std::string before;
+    if (control.request("GET", "/status", "", before) != 200)
+    {
+        fprintf(stderr, "%s:%d: GET /status failed\n", options.host.c_str(), options.port);
+        return 2;
+    }
+
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point end = start + std::chrono::seconds(options.duration);
+
+    std::vector<Result> results(options.connections);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < options.connections; i++)
+    {
+        threads.emplace_back(worker, std::cref(options), i, end, std::ref(results[i]));
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Let the queue drain, so every frame is either sent or coalesced
+    std::string after;
+    const Clock::time_point deadline = Clock::now() + std::chrono::seconds(30);
+    while (control.request("GET", "/status", "", after) == 200 && after.find("\"busy\":true") != std::string::npos &&
+           Clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    Result total;
+    for (const Result &result : results)
+    {
+        total.latencies.insert(total.latencies.end(), result.latencies.begin(), result.latencies.end());
+        total.requests += result.requests;
+        total.failed += result.failed;
+        total.frames += result.frames;
+    }
+    std::sort(total.latencies.begin(), total.latencies.end());
+
+    auto percentile = [&](double p)
+    {
+        if (total.latencies.empty())
+        {
+            return 0.0;
+        }
+        return total.latencies[std::min(total.latencies.size() - 1, (size_t)(p / 100 * total.latencies.size()))];
+    };
+
+    const long long sent = statusValue(after, "sent") - statusValue(before, "sent");
+    const long long coalesced = statusValue(after, "coalesced") - statusValue(before, "coalesced");
+    const long long dropped = (long long)total.frames - sent - coalesced;
+
+    printf("connections: %d, duration: %.1f s\n", options.connections, elapsed);
+    printf("requests:    %llu (%llu failed), %.1f req/s\n",
+           (unsigned long long)total.requests, (unsigned long long)total.failed, total.requests / elapsed);
+    printf("latency ms:  p50 %.2f, p90 %.2f, p99 %.2f, max %.2f\n",
+           percentile(50), percentile(90), percentile(99), (total.latencies.empty()) ? 0.0 : total.latencies.back());
+    printf("frames:      %llu uploaded, %lld sent, %lld coalesced, %lld dropped\n",
+           (unsigned long long)total.frames, sent, coalesced, dropped);
+
+    // Only servers with a frame cache report it
+    if (statusValue(after, "hits") >= 0)
+    {
+        printf("cache:       %lld hits, %lld misses\n",
+               statusValue(after, "hits") - statusValue(before, "hits"),
+               statusValue(after, "misses") - statusValue(before, "misses"));
+    }
+
+    return (total.failed == 0 && dropped == 0) ? 0 : 1;
+}
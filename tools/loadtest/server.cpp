@@ -0,0 +1,348 @@
+/**
+ * @file server.cpp
+ * Host HTTP server for the MobiDOT command core
+ *
+ * Serves the same commands as the ESP8266 (POST /command/<name>, GET /status) from src/command with the real MobiDOT
+ * library behind it. Like on the ESP8266 everything runs on one thread: requests are handled in between calls to
+ * MobiDOT::loop(), and writing a chunk to the simulated bus blocks for the time it takes at the configured baud rate.
+ * Use loadgen.cpp to put load on it.
+ *
+ * Build: g++ -std=c++17 -O2 -I tools/loadtest/host -I src -o mobidot-server tools/loadtest/server.cpp src/command/command.cpp src/mobidot/[a-z]*.cpp
+ * Usage: mobidot-server [--port 8080] [--unpaced]
+ *   --port     TCP port to listen on
+ *   --unpaced  Do not wait for the bus time, measures the command and encode path only
+ * Prints the request, frame and cache counters on exit (Ctrl+C).
+ *
+ * Arne van Iterson, 2023
+ */
+
+#include <Arduino.h>
+#include <SoftwareSerial.h>
+
+#include <arpa/inet.h>
+#include <csignal>
+#include <map>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "mobidot/mobidot.hpp"
+#include "mobidot/framecache.hpp"
+#include "command/command.hpp"
+
+static volatile sig_atomic_t running = 1;
+
+/**
+ * @class FormArgs class
+ * Parameters decoded from a query string or an application/x-www-form-urlencoded body
+ */
+class FormArgs : public CommandArgs
+{
+public:
+    void parse(const std::string &text)
+    {
+        size_t start = 0;
+        while (start < text.size())
+        {
+            size_t end = text.find('&', start);
+            if (end == std::string::npos)
+            {
+                end = text.size();
+            }
+
+            const std::string pair = text.substr(start, end - start);
+            const size_t equals = pair.find('=');
+            if (equals == std::string::npos)
+            {
+                this->VALUES.emplace_back(decode(pair), "");
+            }
+            else
+            {
+                this->VALUES.emplace_back(decode(pair.substr(0, equals)), decode(pair.substr(equals + 1)));
+            }
+            start = end + 1;
+        }
+    }
+
+    const char *get(const char *name) const override
+    {
+        for (const auto &value : this->VALUES)
+        {
+            if (value.first == name)
+            {
+                return value.second.c_str();
+            }
+        }
+        return nullptr;
+    }
+
+private:
+    std::vector<std::pair<std::string, std::string>> VALUES;
+
+    // Same decoding as AsyncWebServer: '+' is a space, %xx is a byte
+    static std::string decode(const std::string &text)
+    {
+        std::string result;
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            if (text[i] == '+')
+            {
+                result += ' ';
+            }
+            else if (text[i] == '%' && i + 2 < text.size())
+            {
+                result += (char)strtol(text.substr(i + 1, 2).c_str(), nullptr, 16);
+                i += 2;
+            }
+            else
+            {
+                result += text[i];
+            }
+        }
+        return result;
+    }
+};
+
+/**
+ * Connection with the bytes received so far
+ */
+struct Client
+{
+    int fd;
+    std::string input;
+};
+
+static const char *reason(int status)
+{
+    switch (status)
+    {
+    case 200:
+        return "OK";
+    case 400:
+        return "Bad Request";
+    case 404:
+        return "Not Found";
+    case 405:
+        return "Method Not Allowed";
+    default:
+        return "Internal Server Error";
+    }
+}
+
+static bool sendAll(int fd, const std::string &data)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        const ssize_t result = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (result <= 0)
+        {
+            return false;
+        }
+        sent += result;
+    }
+    return true;
+}
+
+/**
+ * Handles every complete request in the input of a client
+ * @returns False if the connection has to be closed
+ */
+static bool handle(Client &client, CommandCore &core, std::map<std::string, uint64_t> &counters)
+{
+    while (true)
+    {
+        const size_t headerEnd = client.input.find("\r\n\r\n");
+        if (headerEnd == std::string::npos)
+        {
+            return client.input.size() < 16384;
+        }
+
+        const std::string header = client.input.substr(0, headerEnd);
+        size_t length = 0;
+        bool close = false;
+
+        // Header names are case insensitive
+        std::string lower = header;
+        for (char &c : lower)
+        {
+            c = tolower(c);
+        }
+        const size_t contentLength = lower.find("\r\ncontent-length:");
+        if (contentLength != std::string::npos)
+        {
+            length = strtoul(header.c_str() + contentLength + 17, nullptr, 10);
+        }
+        close = lower.find("\r\nconnection: close") != std::string::npos;
+
+        if (client.input.size() < headerEnd + 4 + length)
+        {
+            return true;
+        }
+
+        const std::string body = client.input.substr(headerEnd + 4, length);
+        client.input.erase(0, headerEnd + 4 + length);
+
+        // Request line: METHOD /path?query HTTP/1.1
+        const size_t methodEnd = header.find(' ');
+        const size_t targetEnd = header.find(' ', methodEnd + 1);
+        const std::string method = header.substr(0, methodEnd);
+        const std::string target = header.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+        const size_t question = target.find('?');
+        const std::string path = target.substr(0, question);
+
+        FormArgs args;
+        if (question != std::string::npos)
+        {
+            args.parse(target.substr(question + 1));
+        }
+        args.parse(body);
+
+        char response[COMMAND_RESPONSE_SIZE] = "{}";
+        int status = 404;
+        if (path == "/status" && method == "GET")
+        {
+            status = core.execute("status", args, response, sizeof(response));
+        }
+        else if (path.compare(0, 9, "/command/") == 0)
+        {
+            status = (method == "POST") ? core.execute(path.c_str() + 9, args, response, sizeof(response)) : 405;
+        }
+        counters[path + " " + std::to_string(status)]++;
+
+        char head[160];
+        snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Type: text/json\r\nContent-Length: %zu\r\n%s\r\n",
+                 status, reason(status), strlen(response), (close) ? "Connection: close\r\n" : "");
+        if (!sendAll(client.fd, std::string(head) + response) || close)
+        {
+            return false;
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int port = 8080;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc)
+            port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--unpaced") == 0)
+            softwareSerialPaced = false;
+        else
+        {
+            fprintf(stderr, "usage: %s [--port 8080] [--unpaced]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    MobiDOT mobidot(/* rx */ 0, /* tx */ 0, /* ctrl */ 0);
+    MobiDOTFrameCache cache(mobidot);
+    CommandCore core(mobidot, &cache);
+
+    const int listener = socket(AF_INET, SOCK_STREAM, 0);
+    const int yes = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (bind(listener, (sockaddr *)&address, sizeof(address)) != 0 || listen(listener, 64) != 0)
+    {
+        perror("listen");
+        return 1;
+    }
+
+    signal(SIGINT, [](int) { running = 0; });
+    signal(SIGTERM, [](int) { running = 0; });
+    printf("listening on 127.0.0.1:%d, bus %s\n", port, (softwareSerialPaced) ? "paced" : "unpaced");
+    fflush(stdout);
+
+    std::vector<Client> clients;
+    std::map<std::string, uint64_t> counters;
+
+    while (running)
+    {
+        std::vector<pollfd> fds;
+        fds.push_back({listener, POLLIN, 0});
+        for (const Client &client : clients)
+        {
+            fds.push_back({client.fd, POLLIN, 0});
+        }
+
+        // Do not sleep while frames are waiting for the bus
+        if (poll(fds.data(), fds.size(), (mobidot.isBusy()) ? 0 : 50) < 0)
+        {
+            continue;
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            const int fd = accept(listener, nullptr, nullptr);
+            if (fd >= 0)
+            {
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+                clients.push_back({fd, ""});
+            }
+        }
+
+        for (size_t i = 1; i < fds.size(); i++)
+        {
+            Client &client = clients[i - 1];
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+            {
+                continue;
+            }
+
+            char data[4096];
+            const ssize_t received = recv(client.fd, data, sizeof(data), 0);
+            if (received > 0)
+            {
+                client.input.append(data, received);
+            }
+            if (received <= 0 || !handle(client, core, counters))
+            {
+                close(client.fd);
+                client.fd = -1;
+            }
+        }
+
+        for (size_t i = 0; i < clients.size();)
+        {
+            if (clients[i].fd < 0)
+            {
+                clients.erase(clients.begin() + i);
+            }
+            else
+            {
+                i++;
+            }
+        }
+
+        // One chunk per iteration, like loop() on the ESP8266
+        mobidot.loop();
+    }
+
+    printf("\nrequests:\n");
+    for (const auto &counter : counters)
+    {
+        printf("  %-28s %llu\n", counter.first.c_str(), (unsigned long long)counter.second);
+    }
+    printf("frames: %u sent, %u coalesced, %u dropped, %llu bytes on the bus\n",
+           mobidot.getSentFrames(), mobidot.getCoalescedFrames(), mobidot.getDroppedFrames(),
+           (unsigned long long)softwareSerialBytes);
+    printf("cache: %u hits, %u misses\n", cache.getHits(), cache.getMisses());
+
+    for (const Client &client : clients)
+    {
+        close(client.fd);
+    }
+    close(listener);
+    return 0;
+}
@@ -0,0 +1,188 @@
+/**
+ * @file check.cpp
+ * Host check of the transmit queue of the MobiDOT library
+ *
+ * Queues frames while the bus is busy, the way loop() of main.cpp interleaves with the web handlers, and compares
+ * the framebuffer afterwards with a second MobiDOT that sent the same frames one by one in the order they have to
+ * show up on the display. Covers frames appended to a queued frame, frames replaced by one that sets every pixel and
+ * frames preempted by a frame of a higher priority.
+ *
+ * Build: g++ -std=c++17 -O2 -I tools/loadtest/host -I src -o mobidot-queue tools/queue/check.cpp src/mobidot/[a-z]*.cpp
+ * Usage: mobidot-queue
+ * Exits with status 1 if any case differs.
+ *
+ * Arne van Iterson, 2023
+ */
+
+#include <Arduino.h>
+#include <SoftwareSerial.h>
+
+#include <functional>
+
+#include "mobidot/mobidot.hpp"
+#include "mobidot/bands.hpp"
+
+using Draw = std::function<void(MobiDOT &)>;
+
+/**
+ * @class Check class
+ * Queued controller and the reference it is compared with
+ */
+class Check
+{
+public:
+    Check(const char name[]) : NAME(name)
+    {
+        // Something to preempt or replace, but not what every case ends with
+        this->PATTERN.setPixel(1, 1, true);
+        this->PATTERN.setPixel(30, 5, true);
+    }
+
+    /**
+     * queue function
+     * Queues a frame on the checked controller, the reference sends it when show() is called
+     */
+    void queue(MobiDOT::Display type, const Draw &draw, MobiDOT::Priority priority = MobiDOT::Priority::NORMAL)
+    {
+        this->QUEUED.selectDisplay(type);
+        draw(this->QUEUED);
+        this->QUEUED.update(priority);
+    }
+
+    /**
+     * show function
+     * Sends a frame on the reference, in the order the display has to show them
+     */
+    void show(MobiDOT::Display type, const Draw &draw)
+    {
+        this->REFERENCE.selectDisplay(type);
+        draw(this->REFERENCE);
+        this->REFERENCE.update();
+        drain(this->REFERENCE);
+    }
+
+    /**
+     * send function
+     * Writes chunks of the queued frames to the bus
+     * @param count Amount of chunks, everything if 0
+     */
+    void send(uint count = 0)
+    {
+        if (count == 0)
+        {
+            drain(this->QUEUED);
+        }
+        for (uint i = 0; i < count; i++)
+        {
+            this->QUEUED.loop();
+        }
+    }
+
+    /**
+     * result function
+     * @returns True if every display of both controllers shows the same
+     */
+    bool result()
+    {
+        this->send();
+
+        bool same = true;
+        for (uint i = 0; i < MOBIDOT_DISPLAY_COUNT; i++)
+        {
+            const MobiDOTBands &expected = this->REFERENCE.getFramebuffer((MobiDOT::Display)i);
+            const MobiDOTBands &shown = this->QUEUED.getFramebuffer((MobiDOT::Display)i);
+            for (uint j = 0; j < expected.getBands(); j++)
+            {
+                same = same && memcmp(expected.getBand(j), shown.getBand(j), expected.getWidth()) == 0;
+            }
+        }
+
+        printf("%-4s %-44s %u sent, %u coalesced, %u dropped\n", (same) ? "ok" : "FAIL", this->NAME,
+               this->QUEUED.getSentFrames(), this->QUEUED.getCoalescedFrames(), this->QUEUED.getDroppedFrames());
+        return same;
+    }
+
+    const MobiDOTBands &pattern()
+    {
+        return this->PATTERN;
+    }
+
+private:
+    const char *NAME;
+    MobiDOT QUEUED = MobiDOT(/* rx */ 0, /* tx */ 0, /* ctrl */ 0);
+    MobiDOT REFERENCE = MobiDOT(/* rx */ 0, /* tx */ 0, /* ctrl */ 0);
+    MobiDOTBands PATTERN = MobiDOTBands(MOBIDOT_WIDTH_SIDE, MOBIDOT_HEIGHT_SIDE);
+
+    static void drain(MobiDOT &mobidot)
+    {
+        while (mobidot.isBusy())
+        {
+            mobidot.loop();
+        }
+    }
+};
+
+int main()
+{
+    softwareSerialPaced = false;
+    const MobiDOT::Display side = MobiDOT::Display::SIDE;
+    const MobiDOT::Display rear = MobiDOT::Display::REAR;
+    bool result = true;
+
+    {
+        Check check("partial frames behind a busy bus");
+        const Draw full = [&check](MobiDOT &mobidot) { mobidot.drawBands(check.pattern()); };
+        const Draw first = [](MobiDOT &mobidot) { mobidot.drawRect(3, 3, 10, 1, true); };
+        const Draw second = [](MobiDOT &mobidot) { mobidot.drawRect(3, 3, 11, 2, false); };
+        check.queue(side, full);
+        check.send(1);
+        check.queue(side, first);
+        check.queue(side, second);
+        check.show(side, full);
+        check.show(side, first);
+        check.show(side, second);
+        result &= check.result();
+    }
+
+    {
+        Check check("full frame replaces queued frames");
+        const Draw partial = [](MobiDOT &mobidot) { mobidot.drawRect(3, 3, 10, 1, true); };
+        const Draw full = [&check](MobiDOT &mobidot) { mobidot.drawBands(check.pattern()); };
+        check.queue(side, partial);
+        check.send(1);
+        check.queue(side, [](MobiDOT &mobidot) { mobidot.drawRect(5, 5, 50, 1, true); });
+        check.queue(side, full);
+        check.show(side, partial);
+        check.show(side, full);
+        result &= check.result();
+    }
+
+    {
+        Check check("urgent partial frame preempts a full frame");
+        const Draw full = [&check](MobiDOT &mobidot) { mobidot.drawBands(check.pattern()); };
+        const Draw urgent = [](MobiDOT &mobidot) { mobidot.drawRect(20, 5, 20, 1, true); };
+        check.queue(side, full);
+        check.send(3);
+        check.queue(side, urgent, MobiDOT::Priority::URGENT);
+        check.show(side, full);
+        check.show(side, urgent);
+        result &= check.result();
+    }
+
+    {
+        Check check("urgent frame on another display");
+        const Draw full = [&check](MobiDOT &mobidot) { mobidot.drawBands(check.pattern()); };
+        const Draw partial = [](MobiDOT &mobidot) { mobidot.drawRect(4, 4, 28, 0, false); };
+        const Draw urgent = [](MobiDOT &mobidot) { mobidot.drawRect(8, 8, 2, 2, true); };
+        check.queue(side, full);
+        check.send(3);
+        check.queue(side, partial);
+        check.queue(rear, urgent, MobiDOT::Priority::URGENT);
+        check.show(side, full);
+        check.show(side, partial);
+        check.show(rear, urgent);
+        result &= check.result();
+    }
+
+    return (result) ? 0 : 1;
+}
@@ -0,0 +1,524 @@
+/**
+ * @file client.cpp
+ * Reference client for the serial link of the MobiDOT web app
+ *
+ * Streams frames to the board over the USB serial port using the framed protocol of src/link (see link.hpp for the
+ * layout of the messages). Every frame waits for its ACK before the next one is sent, a frame is sent again when its
+ * reply is lost or it is answered with a NAK because of a CRC error. Anything on the port that is not a reply, like
+ * the debug prints of the board, is skipped. Works against the board as well as device.cpp on a pseudo terminal.
+ *
+ * Build: g++ -std=c++17 -O2 -o mobidot-serial tools/serial/client.cpp
+ * Usage: mobidot-serial <port> [--display rear] [--mode full] [--count 20] [--file capture.bin] [--urgent] [--timeout 5000]
+ *   --display  front, rear or side
+ *   --mode     full: random bitmaps, delta: one FULL followed by random rectangles, raw: the frames of --file
+ *   --count    Frames to send, ignored with --mode raw
+ *   --file     Frames in wire format, e.g. captured from MobiDOT::onFrame(), their address picks the display
+ *   --urgent   Send the frames with priority URGENT
+ *   --timeout  Milliseconds to wait for a reply before sending a frame again
+ * Exits with status 1 if any frame was not acknowledged.
+ *
+ * Arne van Iterson, 2023
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <poll.h>
+#include <random>
+#include <string>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+/* Protocol constants, see src/link/link.hpp */
+#define SERIALLINK_VERSION 1
+#define SERIALLINK_SYNC_0 0xa5
+#define SERIALLINK_SYNC_1 0x5a
+#define SERIALLINK_HEADER_SIZE 8
+#define SERIALLINK_CRC_SIZE 2
+#define SERIALLINK_FLAG_URGENT 0x01
+
+enum Type
+{
+    HELLO = 0x00,
+    FULL = 0x01,
+    DELTA = 0x02,
+    RAW = 0x03,
+    ACK = 0x80,
+    NAK = 0x81
+};
+
+enum Status
+{
+    QUEUED = 0,
+    UNCHANGED = 1,
+    DUPLICATE = 2,
+    BAD_CRC = 3,
+    BAD_TYPE = 4,
+    BAD_DISPLAY = 5,
+    BAD_PAYLOAD = 6,
+    REFUSED = 7
+};
+
+static const char *const STATUS_NAMES[] = {"queued", "unchanged", "duplicate", "bad crc", "bad type",
+                                           "bad display", "bad payload", "refused"};
+
+/* Order of MobiDOT::Display */
+static const char *const DISPLAY_NAMES[] = {"front", "rear", "side"};
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options
+{
+    std::string port;
+    int display = 1;
+    std::string mode = "full";
+    int count = 20;
+    std::string file;
+    bool urgent = false;
+    int timeout = 5000;
+};
+
+/**
+ * Message in either direction
+ */
+struct Message
+{
+    uint8_t type = 0;
+    uint8_t flags = 0;
+    uint8_t display = 0;
+    uint8_t sequence = 0;
+    std::vector<uint8_t> payload;
+};
+
+/**
+ * Size of a display as reported by HELLO
+ */
+struct Display
+{
+    uint8_t address;
+    uint8_t width;
+    uint8_t height;
+};
+
+static uint16_t crc(uint16_t value, const uint8_t data[], size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        value ^= data[i] << 8;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            value = (value & 0x8000) ? (value << 1) ^ 0x1021 : value << 1;
+        }
+    }
+    return value;
+}
+
+/**
+ * @class Port class
+ * Serial port in raw mode with a parser for the replies
+ */
+class Port
+{
+public:
+    ~Port()
+    {
+        if (this->FD >= 0)
+        {
+            close(this->FD);
+        }
+    }
+
+    bool open(const std::string &path)
+    {
+        this->FD = ::open(path.c_str(), O_RDWR | O_NOCTTY);
+        if (this->FD < 0)
+        {
+            return false;
+        }
+
+        // 115200 baud like DEBUG_BAUDRATE of main.cpp, a pseudo terminal ignores it
+        termios settings;
+        if (tcgetattr(this->FD, &settings) == 0)
+        {
+            cfmakeraw(&settings);
+            cfsetspeed(&settings, B115200);
+            tcsetattr(this->FD, TCSANOW, &settings);
+        }
+        tcflush(this->FD, TCIOFLUSH);
+        return true;
+    }
+
+    bool send(const Message &message)
+    {
+        std::vector<uint8_t> data = {SERIALLINK_SYNC_0, SERIALLINK_SYNC_1, message.type, message.flags,
+                                     message.display, message.sequence, (uint8_t)message.payload.size(),
+                                     (uint8_t)(message.payload.size() >> 8)};
+        data.insert(data.end(), message.payload.begin(), message.payload.end());
+
+        const uint16_t check = crc(0xffff, data.data() + 2, data.size() - 2);
+        data.push_back(check);
+        data.push_back(check >> 8);
+
+        size_t written = 0;
+        while (written < data.size())
+        {
+            const ssize_t result = write(this->FD, data.data() + written, data.size() - written);
+            if (result <= 0)
+            {
+                return false;
+            }
+            written += result;
+        }
+        this->BYTES += data.size();
+        return true;
+    }
+
+    /**
+     * receive function
+     * Waits for the next reply with a valid CRC
+     * @returns False if none arrived before the deadline
+     */
+    bool receive(Message &message, Clock::time_point deadline)
+    {
+        while (true)
+        {
+            if (this->parse(message))
+            {
+                return true;
+            }
+
+            const int remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+            if (remaining <= 0)
+            {
+                return false;
+            }
+
+            pollfd fd = {this->FD, POLLIN, 0};
+            if (poll(&fd, 1, remaining) <= 0)
+            {
+                continue;
+            }
+
+            uint8_t data[512];
+            const ssize_t received = read(this->FD, data, sizeof(data));
+            if (received < 0)
+            {
+                return false;
+            }
+            this->INPUT.insert(this->INPUT.end(), data, data + received);
+        }
+    }
+
+    uint64_t getBytes()
+    {
+        return this->BYTES;
+    }
+
+    uint64_t getSkipped()
+    {
+        return this->SKIPPED;
+    }
+
+private:
+    int FD = -1;
+    std::vector<uint8_t> INPUT;
+    uint64_t BYTES = 0;   // Bytes sent
+    uint64_t SKIPPED = 0; // Bytes received that were not part of a reply
+
+    bool parse(Message &message)
+    {
+        while (this->INPUT.size() >= SERIALLINK_HEADER_SIZE + SERIALLINK_CRC_SIZE)
+        {
+            if (this->INPUT[0] != SERIALLINK_SYNC_0 || this->INPUT[1] != SERIALLINK_SYNC_1)
+            {
+                this->skip();
+                continue;
+            }
+
+            // Replies are short, a longer length means the sync bytes were part of something else
+            const size_t length = this->INPUT[6] | this->INPUT[7] << 8;
+            const size_t size = SERIALLINK_HEADER_SIZE + length + SERIALLINK_CRC_SIZE;
+            if (length > 256)
+            {
+                this->skip();
+                continue;
+            }
+            if (this->INPUT.size() < size)
+            {
+                return false;
+            }
+
+            const uint16_t check = crc(0xffff, this->INPUT.data() + 2, SERIALLINK_HEADER_SIZE - 2 + length);
+            if (check != (this->INPUT[size - 2] | this->INPUT[size - 1] << 8))
+            {
+                this->skip();
+                continue;
+            }
+
+            message.type = this->INPUT[2];
+            message.flags = this->INPUT[3];
+            message.display = this->INPUT[4];
+            message.sequence = this->INPUT[5];
+            message.payload.assign(this->INPUT.begin() + SERIALLINK_HEADER_SIZE,
+                                   this->INPUT.begin() + SERIALLINK_HEADER_SIZE + length);
+            this->INPUT.erase(this->INPUT.begin(), this->INPUT.begin() + size);
+            return true;
+        }
+        return false;
+    }
+
+    // Drops bytes up to the next possible start of a reply
+    void skip()
+    {
+        size_t next = 1;
+        while (next < this->INPUT.size() && this->INPUT[next] != SERIALLINK_SYNC_0)
+        {
+            next++;
+        }
+        this->INPUT.erase(this->INPUT.begin(), this->INPUT.begin() + next);
+        this->SKIPPED += next;
+    }
+};
+
+/**
+ * Results of a run
+ */
+struct Result
+{
+    uint64_t statuses[8] = {0};
+    uint64_t resent = 0;
+    uint64_t failed = 0;
+};
+
+/**
+ * Sends a frame until it is acknowledged
+ * @returns Status of the reply, -1 if there was none
+ */
+static int exchange(Port &port, Message &message, const Options &options, Result &result)
+{
+    for (int attempt = 0; attempt < 3; attempt++)
+    {
+        if (attempt > 0)
+        {
+            result.resent++;
+        }
+        if (!port.send(message))
+        {
+            return -1;
+        }
+
+        const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(options.timeout);
+        Message reply;
+        while (port.receive(reply, deadline))
+        {
+            // Late replies to frames that were sent again
+            if (reply.sequence != message.sequence || reply.payload.empty() || (reply.type != ACK && reply.type != NAK))
+            {
+                continue;
+            }
+
+            const uint8_t status = reply.payload[0];
+            if (reply.type == NAK && status == BAD_CRC)
+            {
+                break;
+            }
+
+            message.payload.swap(reply.payload);
+            return status;
+        }
+    }
+    return -1;
+}
+
+static void randomize(std::vector<uint8_t> &data, std::mt19937 &random)
+{
+    for (uint8_t &value : data)
+    {
+        value = random();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    bool valid = true;
+    for (int i = 1; i < argc; i++)
+    {
+        const bool value = i + 1 < argc;
+        if (strcmp(argv[i], "--display") == 0 && value)
+        {
+            const char *name = argv[++i];
+            options.display = -1;
+            for (int j = 0; j < 3; j++)
+            {
+                options.display = (strcmp(name, DISPLAY_NAMES[j]) == 0) ? j : options.display;
+            }
+        }
+        else if (strcmp(argv[i], "--mode") == 0 && value)
+            options.mode = argv[++i];
+        else if (strcmp(argv[i], "--count") == 0 && value)
+            options.count = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--file") == 0 && value)
+            options.file = argv[++i];
+        else if (strcmp(argv[i], "--urgent") == 0)
+            options.urgent = true;
+        else if (strcmp(argv[i], "--timeout") == 0 && value)
+            options.timeout = atoi(argv[++i]);
+        else if (argv[i][0] != '-' && options.port.empty())
+            options.port = argv[i];
+        else
+            valid = false;
+    }
+
+    const bool modes = options.mode == "full" || options.mode == "delta" || (options.mode == "raw" && !options.file.empty());
+    if (!valid || options.port.empty() || options.display < 0 || !modes)
+    {
+        fprintf(stderr, "usage: %s <port> [--display rear] [--mode full|delta|raw] [--count 20] [--file capture.bin] "
+                        "[--urgent] [--timeout 5000]\n",
+                argv[0]);
+        return 2;
+    }
+
+    Port port;
+    if (!port.open(options.port))
+    {
+        perror(options.port.c_str());
+        return 2;
+    }
+
+    // Reset the sequence numbers and learn the displays
+    Result result;
+    Message hello;
+    hello.type = HELLO;
+    if (exchange(port, hello, options, result) != QUEUED || hello.payload.size() < 2 || hello.payload[1] != SERIALLINK_VERSION)
+    {
+        fprintf(stderr, "%s: no reply to HELLO, or not protocol version %d\n", options.port.c_str(), SERIALLINK_VERSION);
+        return 1;
+    }
+
+    std::vector<Display> displays;
+    for (size_t i = 3; i + 2 < hello.payload.size(); i += 3)
+    {
+        displays.push_back({hello.payload[i], hello.payload[i + 1], hello.payload[i + 2]});
+    }
+    if ((size_t)options.display >= displays.size())
+    {
+        fprintf(stderr, "%s: the board has no %s display\n", options.port.c_str(), DISPLAY_NAMES[options.display]);
+        return 1;
+    }
+
+    // Build every frame up front, so generating them does not count towards the rate
+    std::vector<Message> frames;
+    std::mt19937 random(1);
+    const Display &display = displays[options.display];
+    const size_t stride = (display.width + 7) / 8;
+
+    if (options.mode == "raw")
+    {
+        std::ifstream input(options.file, std::ios::binary);
+        const std::vector<uint8_t> data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+        // Frames run from the start byte up to the stop byte, followed by a 0x00
+        for (size_t i = 0; i < data.size(); i++)
+        {
+            if (data[i] != 0xff || i + 1 >= data.size())
+            {
+                continue;
+            }
+
+            size_t end = i + 1;
+            while (end < data.size() && data[end] != 0xff)
+            {
+                end++;
+            }
+            end = std::min(data.size(), end + 2);
+
+            Message frame;
+            frame.type = RAW;
+            frame.display = 0xff;
+            for (size_t j = 0; j < displays.size(); j++)
+            {
+                frame.display = (displays[j].address == data[i + 1]) ? j : frame.display;
+            }
+            frame.payload.assign(data.begin() + i, data.begin() + end);
+            if (frame.display != 0xff)
+            {
+                frames.push_back(frame);
+            }
+            i = end - 1;
+        }
+    }
+    else
+    {
+        for (int i = 0; i < options.count; i++)
+        {
+            Message frame;
+            frame.display = options.display;
+
+            if (options.mode == "full" || i == 0)
+            {
+                frame.type = FULL;
+                frame.payload.resize(display.height * stride);
+                randomize(frame.payload, random);
+            }
+            else
+            {
+                // One rectangle of up to 16 by 8 pixels somewhere on the display
+                const uint8_t width = 1 + random() % std::min(16, (int)display.width);
+                const uint8_t height = 1 + random() % std::min(8, (int)display.height);
+                frame.type = DELTA;
+                frame.payload = {(uint8_t)(random() % (display.width - width + 1)),
+                                 (uint8_t)(random() % (display.height - height + 1)), width, height};
+                frame.payload.resize(4 + height * ((width + 7) / 8));
+                std::vector<uint8_t> bitmap(frame.payload.size() - 4);
+                randomize(bitmap, random);
+                std::copy(bitmap.begin(), bitmap.end(), frame.payload.begin() + 4);
+            }
+            frames.push_back(frame);
+        }
+    }
+
+    const Clock::time_point start = Clock::now();
+    uint64_t payload = 0;
+
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        Message &frame = frames[i];
+        frame.flags = (options.urgent) ? SERIALLINK_FLAG_URGENT : 0;
+        frame.sequence = i;
+        payload += frame.payload.size();
+
+        const int status = exchange(port, frame, options, result);
+        if (status < 0)
+        {
+            fprintf(stderr, "frame %zu: no reply\n", i);
+            result.failed++;
+            continue;
+        }
+
+        result.statuses[status & 0x07]++;
+        if (status != QUEUED && status != UNCHANGED && status != DUPLICATE)
+        {
+            fprintf(stderr, "frame %zu: %s\n", i, STATUS_NAMES[status & 0x07]);
+            result.failed++;
+        }
+    }
+
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    printf("frames:  %zu sent in %.2f s, %.2f frames/s, %.0f payload bytes/s\n",
+           frames.size(), elapsed, frames.size() / elapsed, payload / elapsed);
+    printf("replies: %llu queued, %llu unchanged, %llu duplicate, %llu failed, %llu resent\n",
+           (unsigned long long)result.statuses[QUEUED], (unsigned long long)result.statuses[UNCHANGED],
+           (unsigned long long)result.statuses[DUPLICATE], (unsigned long long)result.failed,
+           (unsigned long long)result.resent);
+    printf("port:    %llu bytes sent, %llu bytes skipped\n",
+           (unsigned long long)port.getBytes(), (unsigned long long)port.getSkipped());
+
+    return (result.failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,201 @@
+/**
+ * @file device.cpp
+ * Host stand-in for the board behind the serial link
+ *
+ * Runs src/link with the real MobiDOT library on a pseudo terminal, so client.cpp (or any other implementation of the
+ * protocol) can be tested without a board. Like on the ESP8266 everything runs on one thread, and writing a chunk to
+ * the simulated bus blocks for the time it takes at the bus baud rate. The receive buffer of the port is limited to
+ * what setup() in main.cpp gives the ESP8266, the rest waits in the pseudo terminal.
+ *
+ * Build: g++ -std=c++17 -O2 -I tools/loadtest/host -I src -o mobidot-device tools/serial/device.cpp src/link/link.cpp src/mobidot/[a-z]*.cpp
+ * Usage: mobidot-device [--link /tmp/mobidot] [--unpaced] [--chatter]
+ *   --link     Also make the pseudo terminal available under this path
+ *   --unpaced  Do not wait for the bus time
+ *   --chatter  Write a debug line to the port every second, like the prints of main.cpp
+ * Prints the frame counters and how busy the bus was on exit (Ctrl+C).
+ *
+ * Arne van Iterson, 2023
+ */
+
+#include <Arduino.h>
+#include <SoftwareSerial.h>
+
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <string>
+#include <termios.h>
+#include <unistd.h>
+
+#include "mobidot/mobidot.hpp"
+#include "link/link.hpp"
+
+/* Receive buffer of the port, see setup() in main.cpp */
+#define DEVICE_RX_SIZE (SERIALLINK_HEADER_SIZE + SERIALLINK_PAYLOAD_SIZE + SERIALLINK_CRC_SIZE)
+
+static volatile sig_atomic_t running = 1;
+
+/**
+ * @class PtyStream class
+ * Master side of a pseudo terminal
+ */
+class PtyStream : public Stream
+{
+public:
+    PtyStream(int fd) : FD(fd) {}
+
+    int available() override
+    {
+        // Top up the receive buffer like the UART interrupt would
+        if (this->START == this->END)
+        {
+            this->START = this->END = 0;
+        }
+        if (this->END < sizeof(this->BUFFER))
+        {
+            const ssize_t received = ::read(this->FD, this->BUFFER + this->END, sizeof(this->BUFFER) - this->END);
+            if (received > 0)
+            {
+                this->END += received;
+            }
+        }
+        return this->END - this->START;
+    }
+
+    int read() override
+    {
+        return (this->available() > 0) ? this->BUFFER[this->START++] : -1;
+    }
+
+    size_t write(const uint8_t *data, size_t size) override
+    {
+        size_t written = 0;
+        while (written < size)
+        {
+            const ssize_t result = ::write(this->FD, data + written, size - written);
+            if (result < 0 && errno != EAGAIN)
+            {
+                break;
+            }
+            written += (result > 0) ? result : 0;
+        }
+        return written;
+    }
+
+private:
+    int FD;
+    uint8_t BUFFER[DEVICE_RX_SIZE];
+    size_t START = 0;
+    size_t END = 0;
+};
+
+int main(int argc, char *argv[])
+{
+    const char *link = nullptr;
+    bool chatter = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--link") == 0 && i + 1 < argc)
+            link = argv[++i];
+        else if (strcmp(argv[i], "--unpaced") == 0)
+            softwareSerialPaced = false;
+        else if (strcmp(argv[i], "--chatter") == 0)
+            chatter = true;
+        else
+        {
+            fprintf(stderr, "usage: %s [--link /tmp/mobidot] [--unpaced] [--chatter]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    const int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    {
+        perror("posix_openpt");
+        return 1;
+    }
+    const std::string path = ptsname(master);
+
+    // Keep the other side open with raw settings, so clients can come and go without the pseudo terminal hanging up
+    const int slave = open(path.c_str(), O_RDWR | O_NOCTTY);
+    termios settings;
+    tcgetattr(slave, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(slave, TCSANOW, &settings);
+    fcntl(master, F_SETFL, O_NONBLOCK);
+
+    if (link != nullptr)
+    {
+        unlink(link);
+        if (symlink(path.c_str(), link) != 0)
+        {
+            perror("symlink");
+            return 1;
+        }
+    }
+
+    MobiDOT mobidot(/* rx */ 0, /* tx */ 0, /* ctrl */ 0);
+    PtyStream stream(master);
+    SerialLink serialLink(mobidot, stream);
+
+    signal(SIGINT, [](int) { running = 0; });
+    signal(SIGTERM, [](int) { running = 0; });
+    printf("port %s, bus %s\n", (link != nullptr) ? link : path.c_str(), (softwareSerialPaced) ? "paced" : "unpaced");
+    fflush(stdout);
+
+    unsigned long chattered = millis();
+    unsigned long first = 0; // First frame on the bus
+    unsigned long last = 0;  // Last time the bus was busy
+    unsigned long busy = 0;  // Time the bus was busy in between, in microseconds
+    unsigned long before = micros();
+
+    while (running)
+    {
+        // Do not sleep while frames are waiting for the bus
+        if (!mobidot.isBusy())
+        {
+            pollfd fd = {master, POLLIN, 0};
+            poll(&fd, 1, 10);
+        }
+
+        if (chatter && millis() - chattered >= 1000)
+        {
+            chattered = millis();
+            const char line[] = "debug: still alive\r\n";
+            stream.write((const uint8_t *)line, sizeof(line) - 1);
+        }
+
+        serialLink.loop();
+
+        const bool active = mobidot.isBusy();
+        mobidot.loop();
+
+        const unsigned long now = micros();
+        if (active)
+        {
+            busy += now - before;
+            first = (first) ? first : before;
+            last = now;
+        }
+        before = now;
+    }
+
+    // Idle time after the last frame does not count
+    const unsigned long span = (last > first) ? last - first : 0;
+    printf("\nframes: %u queued, %u errors, %u sent, %u coalesced, %u dropped, %llu bytes on the bus\n",
+           serialLink.getFrames(), serialLink.getErrors(), mobidot.getSentFrames(), mobidot.getCoalescedFrames(),
+           mobidot.getDroppedFrames(), (unsigned long long)softwareSerialBytes);
+    if (span > 0)
+    {
+        printf("bus: busy %.1f%% of %.1f s from the first to the last frame\n", 100.0 * busy / span, span / 1e6);
+    }
+
+    if (link != nullptr)
+    {
+        unlink(link);
+    }
+    close(slave);
+    close(master);
+    return 0;
+}